@@ -0,0 +1,365 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+// Measures the throughput and latency of the ingest path behind set_image and set_volume.
+// Runs headless against a minimal application with only the PyData source processors in the
+// network, and writes one JSON object per measurement so results can be compared between builds.
+// A measurement covers the conversion, copy and handover to the outport. The outports are not
+// connected, so the network is never evaluated and nothing is uploaded to the GPU. Each object
+// states this in its "scope" field.
+//
+// Usage: pydata-benchmark [--max-bytes N] [--min-time S] [--threads N] [--filter TEXT]
+//                         [--output FILE]
+
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/network/processornetwork.h>
+#include <inviwo/core/util/logcentral.h>
+#include <modules/pydata/processors/imagesourcebuffer.h>
+#include <modules/pydata/processors/volumesourcebuffer.h>
+#include <modules/pydata/util/ingest.h>
+#include <modules/pydata/util/parallel.h>
+#include <modules/pydata/util/stridedcopy.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+using namespace inviwo;
+
+namespace {
+
+struct DataType {
+    const char* name;
+    NumericType type;
+    size_t itemsize;
+};
+
+const DataType dataTypes[] = {
+    {"uint8", NumericType::UnsignedInteger, 1}, {"int8", NumericType::SignedInteger, 1},
+    {"uint16", NumericType::UnsignedInteger, 2}, {"int16", NumericType::SignedInteger, 2},
+    {"uint32", NumericType::UnsignedInteger, 4}, {"int32", NumericType::SignedInteger, 4},
+    {"uint64", NumericType::UnsignedInteger, 8}, {"int64", NumericType::SignedInteger, 8},
+    {"float16", NumericType::Float, 2},          {"float32", NumericType::Float, 4},
+    {"float64", NumericType::Float, 8},
+    // NumPy bool arrays arrive with the buffer format "?", which is ingested as uint8
+    {"bool", NumericType::UnsignedInteger, 1}};
+
+// What a measurement covers, written along with each result
+const char* measurementScope =
+    "ingest and handover, excludes network evaluation and GPU upload";
+
+// Memory layouts of the source buffer, as they commonly arrive from NumPy
+enum class Layout {
+    Contiguous,  // Packed in row-major order, borrowed when copy is off
+    Strided,     // Every other column of a wider array, e.g. a[:, ::2]
+    Transposed   // Packed in column-major order, e.g. np.asfortranarray(a)
+};
+
+const char* getLayoutName(Layout layout) {
+    switch (layout) {
+        case Layout::Contiguous: return "contiguous";
+        case Layout::Strided: return "strided";
+        case Layout::Transposed: return "transposed";
+    }
+    return "";
+}
+
+struct Options {
+    size_t maxBytes = size_t(1) << 30;
+    double minTime = 0.25;
+    size_t minIterations = 3;
+    size_t maxIterations = 1000;
+    size_t threads = 0;
+    std::string filter;
+    std::string output;
+};
+
+struct Case {
+    std::string function;
+    std::vector<size_t> shape;  // In buffer index order, including components
+    const DataType* dataType;
+    size_t components;
+    Layout layout;
+    bool copy;
+
+    size_t getBytes() const {
+        size_t bytes = dataType->itemsize;
+        for (auto extent : shape)
+            bytes *= extent;
+        return bytes;
+    }
+
+    std::string getShapeString() const {
+        std::stringstream ss;
+        ss << "[";
+        for (size_t i = 0; i < shape.size(); ++i)
+            ss << (i > 0 ? ", " : "") << shape[i];
+        ss << "]";
+        return ss.str();
+    }
+
+    std::string getName() const {
+        std::stringstream ss;
+        ss << function << " " << getShapeString() << " " << dataType->name << " "
+           << getLayoutName(layout) << (copy ? "" : " borrow");
+        return ss.str();
+    }
+};
+
+struct Result {
+    size_t iterations = 0;
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+};
+
+// Source memory shared by all cases, filled once with random bytes
+class SourceMemory {
+public:
+    const void* get(size_t bytes) {
+        if (data_.size() < bytes) {
+            data_.resize(bytes);
+            std::mt19937 engine(42);
+            std::uniform_int_distribution<int> distribution(0, 255);
+            for (auto& value : data_)
+                value = static_cast<unsigned char>(distribution(engine));
+        }
+        return data_.data();
+    }
+
+private:
+    std::vector<unsigned char> data_;
+};
+
+// Describe the source buffer of the case in the requested layout
+pydata::BufferView makeBufferView(const Case& c, SourceMemory& memory) {
+    pydata::BufferView view;
+    view.type = c.dataType->type;
+    view.itemsize = c.dataType->itemsize;
+    view.shape = c.shape;
+    view.writable = true;
+
+    switch (c.layout) {
+        case Layout::Contiguous:
+            view.strides = pydata::getPackedStrides(c.shape, view.itemsize);
+            view.data = memory.get(c.getBytes());
+            break;
+        case Layout::Strided: {
+            auto wide = c.shape;
+            wide[1] *= 2;
+            view.strides = pydata::getPackedStrides(wide, view.itemsize);
+            view.strides[1] *= 2;
+            view.data = memory.get(2 * c.getBytes());
+            break;
+        }
+        case Layout::Transposed: {
+            view.strides.resize(c.shape.size());
+            std::ptrdiff_t stride = view.itemsize;
+            for (size_t i = 0; i < c.shape.size(); ++i) {
+                view.strides[i] = stride;
+                stride *= c.shape[i];
+            }
+            view.data = memory.get(c.getBytes());
+            break;
+        }
+    }
+    return view;
+}
+
+size_t getSourceBytes(const Case& c) {
+    return c.layout == Layout::Strided ? 2 * c.getBytes() : c.getBytes();
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Run the case until both the minimum time and number of iterations are reached. The first call
+// warms up the buffer pool of the processor and is not measured.
+template <typename F>
+Result measure(const Options& options, F call) {
+    call();
+
+    Result result;
+    result.min = std::numeric_limits<double>::max();
+    double total = 0.0;
+    while (result.iterations < options.maxIterations &&
+           (result.iterations < options.minIterations || total < options.minTime)) {
+        auto start = std::chrono::high_resolution_clock::now();
+        call();
+        const double time = secondsSince(start);
+        total += time;
+        result.min = std::min(result.min, time);
+        result.max = std::max(result.max, time);
+        ++result.iterations;
+    }
+    result.mean = total / result.iterations;
+    return result;
+}
+
+void writeResult(std::ostream& os, const Case& c, const Result& result) {
+    const double bytes = static_cast<double>(c.getBytes());
+    os << "{\"function\": \"" << c.function << "\", \"shape\": " << c.getShapeString()
+       << ", \"dtype\": \"" << c.dataType->name << "\", \"components\": " << c.components
+       << ", \"layout\": \"" << getLayoutName(c.layout) << "\", \"copy\": "
+       << (c.copy ? "true" : "false") << ", \"bytes\": " << c.getBytes()
+       << ", \"iterations\": " << result.iterations << ", \"mean_ms\": " << 1000.0 * result.mean
+       << ", \"min_ms\": " << 1000.0 * result.min << ", \"max_ms\": " << 1000.0 * result.max
+       << ", \"gb_per_s\": " << bytes / result.mean * 1e-9 << ", \"scope\": \""
+       << measurementScope << "\"}" << std::endl;
+}
+
+std::vector<Case> getCases(const Options& options) {
+    std::vector<Case> cases;
+    const Layout layouts[] = {Layout::Contiguous, Layout::Strided, Layout::Transposed};
+
+    auto addCases = [&](const std::string& function, std::vector<size_t> shape) {
+        for (const auto& dataType : dataTypes) {
+            for (size_t components = 1; components <= 4; ++components) {
+                for (auto layout : layouts) {
+                    Case c{function, shape, &dataType, components, layout, true};
+                    if (components > 1)
+                        c.shape.push_back(components);
+                    cases.push_back(c);
+
+                    // Contiguous buffers may be borrowed instead of copied
+                    if (layout == Layout::Contiguous) {
+                        c.copy = false;
+                        cases.push_back(c);
+                    }
+                }
+            }
+        }
+    };
+
+    for (size_t size : {64, 256, 1024, 4096})
+        addCases("set_image", {size, size});
+    for (size_t size : {64, 128, 256, 512, 1024})
+        addCases("set_volume", {size, size, size});
+
+    cases.erase(std::remove_if(cases.begin(), cases.end(), [&](const Case& c) {
+        return getSourceBytes(c) > options.maxBytes ||
+               c.getName().find(options.filter) == std::string::npos;
+    }), cases.end());
+    return cases;
+}
+
+Options parseOptions(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+            throw std::runtime_error("Missing value for " + arg);
+        std::string value = argv[++i];
+        if (arg == "--max-bytes")
+            options.maxBytes = std::stoull(value);
+        else if (arg == "--min-time")
+            options.minTime = std::stod(value);
+        else if (arg == "--threads")
+            options.threads = std::stoull(value);
+        else if (arg == "--filter")
+            options.filter = value;
+        else if (arg == "--output")
+            options.output = value;
+        else
+            throw std::runtime_error("Unknown argument " + arg);
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        std::cerr << "Usage: pydata-benchmark [--max-bytes N] [--min-time S] [--threads N] "
+                     "[--filter TEXT] [--output FILE]" << std::endl;
+        return 1;
+    }
+
+    LogCentral::init();
+    InviwoApplication app(argc, argv, "PyData Benchmark");
+    if (options.threads > 0)
+        app.resizePool(options.threads);
+    pydata::setMainThread();
+
+    // Only the source processors are needed, no modules are registered
+    auto network = app.getProcessorNetwork();
+    auto imageSource = new ImageSourceBuffer();
+    imageSource->setIdentifier("ImageSource");
+    network->addProcessor(imageSource);
+    auto volumeSource = new VolumeSourceBuffer();
+    volumeSource->setIdentifier("VolumeSource");
+    network->addProcessor(volumeSource);
+
+    std::ofstream file;
+    if (!options.output.empty()) {
+        file.open(options.output);
+        if (!file) {
+            std::cerr << "Cannot open " << options.output << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& os = options.output.empty() ? std::cout : file;
+
+    std::cerr << "Measuring " << measurementScope << std::endl;
+    SourceMemory memory;
+    auto cases = getCases(options);
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const auto& c = cases[i];
+        std::cerr << "[" << i + 1 << "/" << cases.size() << "] " << c.getName() << std::endl;
+
+        auto buffer = makeBufferView(c, memory);
+        pydata::IngestOptions ingestOptions(c.copy);
+        Result result;
+        if (c.function == "set_image") {
+            result = measure(options, [&]() {
+                pydata::setImage(imageSource, buffer, ingestOptions);
+            });
+        } else {
+            result = measure(options, [&]() {
+                pydata::setVolume(volumeSource, buffer, ingestOptions);
+            });
+        }
+        writeResult(os, c, result);
+    }
+
+    network->clear();
+    return 0;
+}
@@ -0,0 +1,70 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_LAYERRAMBUFFER_H
+#define IVW_LAYERRAMBUFFER_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/datastructures/image/layerramprecision.h>
+
+namespace inviwo {
+
+/**
+ * \class LayerRAMBuffer
+ * \brief Layer RAM representation that borrows memory owned by someone else
+ * The layer counterpart of VolumeRAMBuffer, the data pointer is never deleted and the owner
+ * object is kept alive for as long as the representation exists.
+ */
+template <typename T>
+class LayerRAMBuffer : public LayerRAMPrecision<T> {
+public:
+    LayerRAMBuffer(T* data, size2_t dimensions, LayerType type, std::shared_ptr<void> owner)
+        : LayerRAMPrecision<T>(data, dimensions, type), owner_(std::move(owner)) {
+        this->removeDataOwnership();
+    }
+    virtual ~LayerRAMBuffer() = default;
+
+    const std::shared_ptr<void>& getOwner() const { return owner_; }
+
+private:
+    std::shared_ptr<void> owner_;
+};
+
+/**
+ * Create a LayerRAMBuffer of the given format wrapping the data pointer. The owner is kept alive
+ * by the representation. Returns nullptr if the format is not supported.
+ */
+IVW_MODULE_PYDATA_API std::shared_ptr<LayerRAM> createLayerRAMBuffer(
+    const size2_t& dimensions, LayerType type, const DataFormatBase* format, void* data,
+    std::shared_ptr<void> owner);
+
+} // namespace
+
+#endif // IVW_LAYERRAMBUFFER_H
@@ -0,0 +1,73 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_VOLUMERAMBUFFER_H
+#define IVW_VOLUMERAMBUFFER_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/datastructures/volume/volumeramprecision.h>
+
+namespace inviwo {
+
+/**
+ * \class VolumeRAMBuffer
+ * \brief Volume RAM representation that borrows memory owned by someone else
+ * The data pointer is never deleted by the representation. Instead the owner object is kept
+ * alive for as long as the representation exists and released when it is destroyed, which
+ * makes it possible to wrap e.g. a pinned Python buffer without copying it. The representation
+ * may be destroyed on any thread, owners needing a particular thread, like the GIL for Python
+ * buffers, must hand the release over themselves.
+ */
+template <typename T>
+class VolumeRAMBuffer : public VolumeRAMPrecision<T> {
+public:
+    VolumeRAMBuffer(T* data, size3_t dimensions, std::shared_ptr<void> owner)
+        : VolumeRAMPrecision<T>(data, dimensions), owner_(std::move(owner)) {
+        this->removeDataOwnership();
+    }
+    virtual ~VolumeRAMBuffer() = default;
+
+    const std::shared_ptr<void>& getOwner() const { return owner_; }
+
+private:
+    std::shared_ptr<void> owner_;
+};
+
+/**
+ * Create a VolumeRAMBuffer of the given format wrapping the data pointer. The owner is kept alive
+ * by the representation. Returns nullptr if the format is not supported.
+ */
+IVW_MODULE_PYDATA_API std::shared_ptr<VolumeRAM> createVolumeRAMBuffer(
+    const size3_t& dimensions, const DataFormatBase* format, void* data,
+    std::shared_ptr<void> owner);
+
+} // namespace
+
+#endif // IVW_VOLUMERAMBUFFER_H
@@ -28,9 +28,41 @@
  *********************************************************************************/
 
 #include <modules/pydata/processors/imagesourcebuffer.h>
+#include <modules/pydata/datastructures/layerrambuffer.h>
+#include <modules/pydata/util/downsample.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/datastructures/image/layerram.h>
+
+#include <algorithm>
 
 namespace inviwo {
 
+namespace {
+
+// Return the source downsampled by factor as a new image with one color layer. Only the memory
+// of the source is read. The level is counted against the memory budget for as long as it is
+// alive, which may drop it through the function made by getRelease.
+pydata::Pyramid<Image>::Source downsampleImage(
+    const pydata::Pyramid<Image>::Source& source, size_t factor, pydata::DownsampleMode mode,
+    const DataFormatBase* format, std::function<std::function<bool()>(const Image*)> getRelease) {
+    const auto dimensions = pydata::getDownsampledDimensions(source.dimensions, factor);
+    auto& budget = pydata::MemoryBudget::getPtr();
+    auto memory = budget.allocate(glm::compMul(dimensions) * format->getSize());
+    auto levelRAM = createLayerRAMBuffer(size2_t(dimensions), LayerType::Color, format,
+                                         memory->getData(), memory);
+    if (!levelRAM)
+        throw Exception("Cannot allocate image buffer", IvwContextCustom("downsampleImage"));
+    budget.enforce();
+    pydata::downsample(source.memory, source.dimensions, memory->getData(), format, factor, mode);
+    auto level = std::make_shared<Image>(std::make_shared<Layer>(levelRAM));
+    memory->setRelease(getRelease(level.get()));
+    return {level, memory->getData(), dimensions};
+}
+
+} // namespace
+
 // The Class Identifier has to be globally unique. Use a reverse DNS naming scheme
 const ProcessorInfo ImageSourceBuffer::processorInfo_{
     "se.lathen.ImageSourceBuffer",      // Class identifier
@@ -46,17 +78,180 @@ const ProcessorInfo ImageSourceBuffer::getProcessorInfo() const {
 ImageSourceBuffer::ImageSourceBuffer()
     : Processor()
     , outport_("outport")
+    , pyramidOutport_("pyramid")
+    , poolSize_("poolSize", "Buffer Pool Size", 2, 0, 8)
+    , pyramidLevels_("pyramidLevels", "Pyramid Levels", 1, 1, 8)
+    , pyramidLevel_("pyramidLevel", "Output Level", 0, 0, 7)
+    , pyramidMode_("pyramidMode", "Downsampling")
+    , progressive_("progressive", "Coarsest Level First", true)
+    , coalesce_("coalesce", "Keep Latest Frame Only", false)
+    , handoverPending_(false)
+    , pyramidDropped_(false)
+    , frames_(std::make_shared<pydata::FrameTracker>())
+    , handovers_([this](std::shared_ptr<Image> image, size_t frame) { handOver(image, frame); })
+    , pool_(std::make_shared<pydata::DataPool<Image>>(static_cast<size_t>(poolSize_.get())))
+    , alive_(std::make_shared<bool>(true))
 {
     outport_.setHandleResizeEvents(false);
+    pyramidOutport_.setHandleResizeEvents(false);
     addPort(outport_);
+    addPort(pyramidOutport_);
+    addProperty(poolSize_);
+    poolSize_.onChange([this]() { pool_->setSize(static_cast<size_t>(poolSize_.get())); });
+
+    pyramidMode_.addOption("box", "Box", static_cast<int>(pydata::DownsampleMode::Box));
+    pyramidMode_.addOption("max", "Max", static_cast<int>(pydata::DownsampleMode::Max));
+    pyramidMode_.setSelectedIndex(0);
+    pyramidMode_.setCurrentStateAsDefault();
+    addProperty(pyramidLevels_);
+    addProperty(pyramidLevel_);
+    addProperty(pyramidMode_);
+    addProperty(progressive_);
+    pyramidLevels_.onChange([this]() { buildPyramid(); });
+    pyramidMode_.onChange([this]() { buildPyramid(); });
+    progressive_.onChange([this]() { buildPyramid(); });
+    pyramidLevel_.onChange([this]() { updatePyramidOutport(); });
+
+    addProperty(coalesce_);
+    coalesce_.onChange([this]() { handovers_.setCoalescing(coalesce_.get()); });
 }
+
+ImageSourceBuffer::~ImageSourceBuffer() { frames_->close(); }
     
 void ImageSourceBuffer::process() {
+    if (handoverPending_) {
+        pydata::IngestStats::getPtr().record(pydata::IngestPhase::Evaluate,
+                                             std::chrono::steady_clock::now() - handoverTime_);
+        handoverPending_ = false;
+    }
+    frames_->consume();
+
+    // Pyramid levels dropped by the memory budget are built again once they are needed
+    if (pyramidDropped_)
+        updatePyramidOutport();
 }
 
 void ImageSourceBuffer::setData(std::shared_ptr<Image> image) {
+    // The outport and the network may only be touched from the main thread
+    handovers_.push(std::move(image), frames_->submit());
+}
+
+void ImageSourceBuffer::handOver(std::shared_ptr<Image> image, size_t frame) {
+    // An image that was overtaken by a newer one is not set on the outport
+    if (!frames_->handOver(frame)) {
+        pydata::IngestStats::getPtr().addDropped();
+        return;
+    }
+
+    pydata::PhaseTimer timer(pydata::IngestPhase::Handover);
     outport_.setData(image);
+    levels_.assign(1, image);
+    buildPyramid();
     invalidate(InvalidationLevel::InvalidOutput);
+    handoverTime_ = std::chrono::steady_clock::now();
+    handoverPending_ = true;
+    // Nothing evaluates the processor without a connected outport, nobody would consume the frame
+    if (!outport_.isConnected())
+        frames_->consume();
+}
+
+void ImageSourceBuffer::buildPyramid() {
+    auto image = levels_.empty() ? nullptr : levels_[0];
+    levels_.assign(1, image);
+    pyramidDropped_ = false;
+    const size_t count = static_cast<size_t>(pyramidLevels_.get());
+    if (!image || count < 2) {
+        pyramid_.cancel();
+        updatePyramidOutport();
+        return;
+    }
+
+    // The color layer is read here, on the main thread. Getting the RAM representation may
+    // require a download from the GPU.
+    levels_.resize(count);
+    auto layer = image->getColorLayer();
+    const pydata::Pyramid<Image>::Source level0{
+        image, layer->getRepresentation<LayerRAM>()->getData(), size3_t(layer->getDimensions(), 1)};
+    const auto format = layer->getDataFormat();
+    auto mode = static_cast<pydata::DownsampleMode>(pyramidMode_.get());
+    std::weak_ptr<bool> alive = alive_;
+    auto getRelease = [this, alive](const Image* level) {
+        return releaseLevel(this, alive, level);
+    };
+    auto downsample = [=](const pydata::Pyramid<Image>::Source& source, size_t factor) {
+        return downsampleImage(source, factor, mode, format, getRelease);
+    };
+
+    // Finished levels are handed over on the main thread, unless a newer build has started
+    auto receive = [this](pydata::Pyramid<Image>::Levels levels) {
+        levels_ = levels;
+        updatePyramidOutport();
+        invalidate(InvalidationLevel::InvalidOutput);
+    };
+    auto publish = pyramid_.publishOnMainThread(alive, receive);
+
+    // Images are never written in place, so level 0 needs no lease
+    pyramid_.build(level0, nullptr, count, progressive_.get(), downsample, publish);
+    updatePyramidOutport();
+}
+
+void ImageSourceBuffer::updatePyramidOutport() {
+    if (levels_.empty())
+        return;
+    const auto selected = std::min(static_cast<size_t>(pyramidLevel_.get()), levels_.size() - 1);
+    if (pyramidDropped_ && !levels_[selected] && pyramidOutport_.isConnected()) {
+        buildPyramid();
+        return;
+    }
+
+    // Finer levels are only shown if there is nothing else to show
+    if (auto level = pydata::Pyramid<Image>::getShownLevel(levels_, selected,
+                                                           !pyramidOutport_.hasData()))
+        pyramidOutport_.setData(level);
+}
+
+std::shared_ptr<Image> ImageSourceBuffer::getPooledImage(const size2_t& dimensions,
+                                                         const DataFormatBase* format) {
+    auto matches = [&](const Image& image) {
+        return image.getDimensions() == dimensions && image.getDataFormat() == format;
+    };
+    auto create = [&](std::shared_ptr<pydata::MemoryAllocation> memory) {
+        auto layerRAM = createLayerRAMBuffer(dimensions, LayerType::Color, format,
+                                             memory->getData(), memory);
+        return layerRAM ? std::make_shared<Image>(std::make_shared<Layer>(layerRAM)) : nullptr;
+    };
+    return pool_->get(glm::compMul(dimensions) * format->getSize(), matches, create);
+}
+
+std::function<bool()> ImageSourceBuffer::releaseLevel(ImageSourceBuffer* processor,
+                                                      std::weak_ptr<bool> alive,
+                                                      const Image* key) {
+    return [processor, alive, key]() {
+        // The processor and its outports may only be touched from the main thread
+        if (!pydata::isMainThread()) {
+            pydata::MemoryBudget::getPtr().enforceOnMainThread();
+            return false;
+        }
+        return alive.lock() && processor->dropLevel(key);
+    };
+}
+
+bool ImageSourceBuffer::dropLevel(const Image* key) {
+    const bool shown = pyramidOutport_.hasData() && pyramidOutport_.getData().get() == key;
+    // A level on the connected outport is in use
+    if (shown && pyramidOutport_.isConnected())
+        return false;
+
+    std::shared_ptr<const Image> level = pydata::Pyramid<Image>::takeLevel(levels_, key);
+    if (level)
+        pyramidDropped_ = true;
+    if (shown) {
+        level = pyramidOutport_.getData();
+        pyramidOutport_.setData(std::shared_ptr<Image>());
+    }
+
+    // Jobs building the pyramid or consumers may still hold the level, it is freed with them
+    return level && level.use_count() == 1;
 }
 
 } // namespace
@@ -33,7 +33,17 @@
 #include <modules/pydata/pydatamoduledefine.h>
 #include <inviwo/core/common/inviwo.h>
 #include <inviwo/core/processors/processor.h>
+#include <inviwo/core/properties/boolproperty.h>
+#include <inviwo/core/properties/optionproperty.h>
+#include <inviwo/core/properties/ordinalproperty.h>
 #include <inviwo/core/ports/imageport.h>
+#include <modules/pydata/util/datapool.h>
+#include <modules/pydata/util/frametracker.h>
+#include <modules/pydata/util/handoverqueue.h>
+#include <modules/pydata/util/pyramid.h>
+
+#include <chrono>
+#include <functional>
 
 namespace inviwo {
 
@@ -61,17 +71,78 @@ namespace inviwo {
 class IVW_MODULE_PYDATA_API ImageSourceBuffer : public Processor { 
 public:
     ImageSourceBuffer();
-    virtual ~ImageSourceBuffer() = default;
+    virtual ~ImageSourceBuffer();
      
     virtual void process() override;
 
     virtual const ProcessorInfo getProcessorInfo() const override;
     static const ProcessorInfo processorInfo_;
 
+    /**
+     * Set the data of the outport and invalidate the network. May be called from any thread,
+     * the data is handed over on the main thread. If coalescing is on, an image still waiting
+     * for the main thread is replaced and dropped, which returns its buffer to the pool.
+     */
     void setData(std::shared_ptr<Image> image);
 
+    /**
+     * Return an image of the given dimensions and format to be filled through the editable RAM
+     * representation of its color layer and passed to setData. Images that are no longer
+     * referenced outside the pool are reused, so streaming frames of the same size does not
+     * allocate once the pool is warm. The buffers are counted against the memory budget, which
+     * drops free images from the pool when it is exceeded. May be called from any thread.
+     */
+    std::shared_ptr<Image> getPooledImage(const size2_t& dimensions, const DataFormatBase* format);
+
+    /**
+     * Return the tracker of the frames set and consumed by the network. It outlives the
+     * processor, waiting threads are woken up when the processor is removed. Frames handed over
+     * while the outport is not connected are consumed right away.
+     */
+    std::shared_ptr<pydata::FrameTracker> getFrameTracker() const { return frames_; }
+
 private:
+    // Set the data on the outport, on the main thread
+    void handOver(std::shared_ptr<Image> image, size_t frame);
+
+    // Start building the pyramid of the current image, or drop it if only one level is used
+    void buildPyramid();
+    // Set the selected pyramid level, or the nearest coarser one that is done, on the outport
+    void updatePyramidOutport();
+
     ImageOutport outport_;
+    ImageOutport pyramidOutport_;
+    IntProperty poolSize_;
+    IntProperty pyramidLevels_;
+    IntProperty pyramidLevel_;
+    OptionPropertyInt pyramidMode_;
+    BoolProperty progressive_;
+    BoolProperty coalesce_;
+
+    // Time of the last handover not yet seen by process, only used on the main thread
+    std::chrono::steady_clock::time_point handoverTime_;
+    bool handoverPending_;
+
+    // A pyramid level was dropped by the memory budget, the pyramid is built again if the
+    // selected level is missing. Only used on the main thread.
+    bool pyramidDropped_;
+
+    // Levels of the current image, the first is the image itself. Only used on the main thread.
+    pydata::Pyramid<Image> pyramid_;
+    pydata::Pyramid<Image>::Levels levels_;
+
+    std::shared_ptr<pydata::FrameTracker> frames_;
+    pydata::HandoverQueue<std::shared_ptr<Image>> handovers_;
+
+    // Pyramid levels may be dropped by the memory budget. It is left to the main thread, and a
+    // level is only dropped if the connected outport does not show it.
+    static std::function<bool()> releaseLevel(ImageSourceBuffer* processor,
+                                              std::weak_ptr<bool> alive, const Image* key);
+    // Drop the level, return true if it is freed. Only called on the main thread.
+    bool dropLevel(const Image* key);
+
+    std::shared_ptr<pydata::DataPool<Image>> pool_;
+    std::shared_ptr<bool> alive_;
 };
 
 } // namespace
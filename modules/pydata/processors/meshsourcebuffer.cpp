@@ -0,0 +1,120 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/processors/meshsourcebuffer.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+namespace inviwo {
+
+// The Class Identifier has to be globally unique. Use a reverse DNS naming scheme
+const ProcessorInfo MeshSourceBuffer::processorInfo_{
+    "se.lathen.MeshSourceBuffer",      // Class identifier
+    "Mesh Source Buffer",              // Display name
+    "Data Input",                       // Category
+    CodeState::Experimental,            // Code state
+    Tags::CPU,                          // Tags
+};
+const ProcessorInfo MeshSourceBuffer::getProcessorInfo() const {
+    return processorInfo_;
+}
+
+MeshSourceBuffer::MeshSourceBuffer()
+    : Processor()
+    , outport_("outport")
+    , vertexCount_(0)
+    , queued_(0)
+    , alive_(std::make_shared<bool>(true))
+{
+    addPort(outport_);
+}
+
+void MeshSourceBuffer::process() {}
+
+void MeshSourceBuffer::setData(Buffers buffers, bool replace) {
+    {
+        // The vertex count is checked against the calls made so far rather than the mesh handed
+        // over, calls from other threads may still be queued
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        size_t count = replace ? 0 : vertexCount_;
+        for (auto& buffer : buffers) {
+            if (count == 0)
+                count = buffer.second->getSize();
+            else if (buffer.second->getSize() != count)
+                throw Exception("Buffers must have one element per vertex", IvwContext);
+        }
+        vertexCount_ = count;
+
+        // The outport and the network may only be touched from the main thread. Calls from other
+        // threads are queued, and dropped if the processor has been removed in the meantime.
+        // Calls on the main thread are queued too while earlier calls are pending, so the
+        // buffers are handed over in the order they were checked.
+        if (!pydata::isMainThread() || queued_ > 0) {
+            ++queued_;
+            std::weak_ptr<bool> alive = alive_;
+            InviwoApplication::getPtr()->dispatchFront([this, alive, buffers, replace]() {
+                if (!alive.lock()) return;
+                {
+                    std::lock_guard<std::mutex> lock(buffersMutex_);
+                    --queued_;
+                }
+                handOver(buffers, replace);
+            });
+            return;
+        }
+    }
+    handOver(buffers, replace);
+}
+
+void MeshSourceBuffer::handOver(Buffers buffers, bool replace) {
+    pydata::PhaseTimer timer(pydata::IngestPhase::Handover);
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex_);
+        if (replace)
+            buffers_.clear();
+        for (auto& buffer : buffers)
+            buffers_[buffer.first] = buffer.second;
+        buffers = buffers_;
+    }
+
+    // A new mesh sharing the buffers, consumers may still use the previous one
+    auto mesh = std::make_shared<Mesh>(DrawType::Points, ConnectivityType::None);
+    for (auto& buffer : buffers)
+        mesh->addBuffer(buffer.first, buffer.second);
+    outport_.setData(mesh);
+    invalidate(InvalidationLevel::InvalidOutput);
+}
+
+size_t MeshSourceBuffer::getVertexCount() const {
+    std::lock_guard<std::mutex> lock(buffersMutex_);
+    return vertexCount_;
+}
+
+} // namespace
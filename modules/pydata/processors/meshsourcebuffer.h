@@ -0,0 +1,101 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_MESHSOURCEBUFFER_H
+#define IVW_MESHSOURCEBUFFER_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/datastructures/geometry/geometrytype.h>
+#include <inviwo/core/datastructures/geometry/mesh.h>
+#include <inviwo/core/processors/processor.h>
+#include <inviwo/core/ports/meshport.h>
+
+#include <map>
+#include <mutex>
+
+namespace inviwo {
+
+/** \docpage{se.lathen.MeshSourceBuffer, Mesh Source Buffer}
+ * ![](se.lathen.MeshSourceBuffer.png?classIdentifier=se.lathen.MeshSourceBuffer)
+ * Outputs a point mesh set from Python, see set_mesh and update_mesh.
+ *
+ * ### Outports
+ *   * __outport__ Mesh with one buffer per attribute, drawn as points.
+ */
+
+/**
+ * \class MeshSourceBuffer
+ * \brief Source of point meshes with one buffer per attribute
+ * Attributes are stored as separate buffers, so one of them can be replaced while the others,
+ * and their representations on the GPU, are shared with the previous mesh.
+ */
+class IVW_MODULE_PYDATA_API MeshSourceBuffer : public Processor {
+public:
+    using Buffers = std::map<BufferType, std::shared_ptr<BufferBase>>;
+
+    MeshSourceBuffer();
+    virtual ~MeshSourceBuffer() = default;
+
+    virtual void process() override;
+
+    virtual const ProcessorInfo getProcessorInfo() const override;
+    static const ProcessorInfo processorInfo_;
+
+    /**
+     * Set the buffers of the mesh and invalidate the network. If replace is set, the mesh only
+     * has the given buffers, otherwise they replace buffers of the same type and the other
+     * buffers are kept. All buffers must have as many elements as the mesh has vertices, which
+     * includes buffers set earlier that are not handed over yet. May be called from any thread,
+     * the data is handed over on the main thread.
+     */
+    void setData(Buffers buffers, bool replace);
+
+    /**
+     * Return the number of vertices of the mesh once all buffers set so far are handed over, or 0
+     * if it has no buffers. May be called from any thread.
+     */
+    size_t getVertexCount() const;
+
+private:
+    void handOver(Buffers buffers, bool replace);
+
+    MeshOutport outport_;
+
+    mutable std::mutex buffersMutex_;
+    Buffers buffers_;
+    size_t vertexCount_;  ///< Vertices of the buffers set so far, including queued ones
+    size_t queued_;       ///< Calls waiting to be handed over on the main thread
+
+    std::shared_ptr<bool> alive_;
+};
+
+} // namespace
+
+#endif // IVW_MESHSOURCEBUFFER_H
@@ -0,0 +1,194 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/processors/sharedmemorysource.h>
+#include <modules/pydata/datastructures/layerrambuffer.h>
+#include <modules/pydata/datastructures/volumerambuffer.h>
+#include <modules/pydata/util/valuestats.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+#include <chrono>
+
+namespace inviwo {
+
+// The Class Identifier has to be globally unique. Use a reverse DNS naming scheme
+const ProcessorInfo SharedMemorySource::processorInfo_{
+    "se.lathen.SharedMemorySource",      // Class identifier
+    "Shared Memory Source",              // Display name
+    "Data Input",                       // Category
+    CodeState::Experimental,            // Code state
+    Tags::CPU,                          // Tags
+};
+const ProcessorInfo SharedMemorySource::getProcessorInfo() const {
+    return processorInfo_;
+}
+
+SharedMemorySource::SharedMemorySource()
+    : Processor()
+    , volumeOutport_("volume")
+    , imageOutport_("image")
+    , name_("name", "Shared Memory Name", "inviwo_ring")
+    , pollInterval_("pollInterval", "Poll Interval", 2, 1, 1000)
+    , valueRange_("valueRange", "Compute Value Range", false)
+    , ringName_(name_.get())
+    , interval_(pollInterval_.get())
+    , stop_(false)
+    , publishPending_(false)
+    , alive_(std::make_shared<bool>(true))
+{
+    addPort(volumeOutport_);
+    addPort(imageOutport_);
+    addProperty(name_);
+    addProperty(pollInterval_);
+    addProperty(valueRange_);
+
+    // The poll thread attaches to the new ring, the current frames stay until it has a frame
+    name_.onChange([this]() {
+        std::lock_guard<std::mutex> lock(pollMutex_);
+        ringName_ = name_.get();
+        pollCondition_.notify_one();
+    });
+    pollInterval_.onChange([this]() {
+        std::lock_guard<std::mutex> lock(pollMutex_);
+        interval_ = pollInterval_.get();
+    });
+
+    pollThread_ = std::thread([this]() { poll(); });
+}
+
+SharedMemorySource::~SharedMemorySource() {
+    {
+        std::lock_guard<std::mutex> lock(pollMutex_);
+        stop_ = true;
+    }
+    pollCondition_.notify_one();
+    pollThread_.join();
+}
+
+void SharedMemorySource::process() {}
+
+void SharedMemorySource::poll() {
+    std::shared_ptr<pydata::SharedMemoryRing> ring;
+    std::uint64_t seenSequence = 0;
+    std::string attachError;
+
+    std::unique_lock<std::mutex> lock(pollMutex_);
+    while (!stop_) {
+        if (ring && ring->getName() != ringName_)
+            ring.reset();
+
+        // The writer may start after the network, keep trying until the ring exists. Errors are
+        // logged once, not on every attempt.
+        if (!ring) {
+            try {
+                ring = pydata::SharedMemoryRing::attach(ringName_);
+                seenSequence = 0;
+                attachError.clear();
+            } catch (const std::exception& e) {
+                if (attachError != e.what()) {
+                    attachError = e.what();
+                    LogWarn(attachError);
+                }
+            }
+        }
+
+        // Only one frame is queued at a time, the latest is picked when it is handled
+        if (ring && !publishPending_ && ring->getWriteSequence() != seenSequence) {
+            seenSequence = ring->getWriteSequence();
+            publishPending_ = true;
+            std::weak_ptr<bool> alive = alive_;
+            InviwoApplication::getPtr()->dispatchFront([this, alive, ring]() {
+                if (alive.lock()) publish(ring);
+            });
+        }
+
+        const auto interval = std::chrono::milliseconds(ring ? interval_ : 100);
+        pollCondition_.wait_for(lock, interval);
+    }
+}
+
+void SharedMemorySource::publish(std::shared_ptr<pydata::SharedMemoryRing> ring) {
+    {
+        std::lock_guard<std::mutex> lock(pollMutex_);
+        publishPending_ = false;
+    }
+
+    pydata::SharedMemoryRing::Frame frame;
+    try {
+        if (!ring->acquireLatest(frame))
+            return;
+    } catch (const std::exception& e) {
+        LogError("Cannot read frame from " << ring->getName() << ": " << e.what());
+        return;
+    }
+
+    // The shape is given in index order, see pydata::prepareVolume and pydata::prepareImage
+    const auto& shape = frame.shape;
+    const bool volume = frame.kind == pydata::SharedMemoryRing::Kind::Volume;
+    const size_t spatial = volume ? 3 : 2;
+    if (shape.size() < spatial || shape.size() > spatial + 1) {
+        LogError("Frame " << frame.sequence << " has " << shape.size() << " dimensions");
+        return;
+    }
+    const size_t components = shape.size() == spatial ? 1 : shape[spatial];
+    auto dataFormat = components <= 4 ? DataFormatBase::get(frame.format.type, components,
+                                                            frame.format.itemsize * 8)
+                                      : nullptr;
+    if (!dataFormat) {
+        LogError("Frame " << frame.sequence << " has an unsupported data format");
+        return;
+    }
+
+    // The lease is kept by the representation and returns the slot to the writer with it
+    if (volume) {
+        auto dimensions = size3_t(shape[1], shape[0], shape[2]);
+        auto volumeRAM = createVolumeRAMBuffer(dimensions, dataFormat, frame.data, frame.lease);
+        if (!volumeRAM)
+            return;
+        auto data = std::make_shared<Volume>(volumeRAM);
+        if (valueRange_.get()) {
+            auto stats = pydata::ValueStatsVisitor::create(dataFormat, 0);
+            const size_t bytes = dataFormat->getSize() * glm::compMul(dimensions);
+            stats->scan(frame.data, bytes);
+            data->dataMap_.dataRange = stats->finish(frame.data, bytes).range;
+            data->dataMap_.valueRange = data->dataMap_.dataRange;
+        }
+        volumeOutport_.setData(data);
+    } else {
+        auto dimensions = size2_t(shape[1], shape[0]);
+        auto layerRAM = createLayerRAMBuffer(dimensions, LayerType::Color, dataFormat, frame.data,
+                                             frame.lease);
+        if (!layerRAM)
+            return;
+        imageOutport_.setData(std::make_shared<Image>(std::make_shared<Layer>(layerRAM)));
+    }
+    invalidate(InvalidationLevel::InvalidOutput);
+}
+
+} // namespace
@@ -0,0 +1,109 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_SHAREDMEMORYSOURCE_H
+#define IVW_SHAREDMEMORYSOURCE_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/processors/processor.h>
+#include <inviwo/core/properties/boolproperty.h>
+#include <inviwo/core/properties/ordinalproperty.h>
+#include <inviwo/core/properties/stringproperty.h>
+#include <inviwo/core/ports/imageport.h>
+#include <inviwo/core/ports/volumeport.h>
+#include <modules/pydata/util/sharedmemoryring.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace inviwo {
+
+/** \docpage{se.lathen.SharedMemorySource, Shared Memory Source}
+ * ![](se.lathen.SharedMemorySource.png?classIdentifier=se.lathen.SharedMemorySource)
+ * Publishes frames written to a shared memory ring by another process, see
+ * pydata::SharedMemoryRing and scripts/shmring.py for the writer side.
+ *
+ * ### Outports
+ *   * __volume__ The latest volume frame.
+ *   * __image__ The latest image frame.
+ *
+ * ### Properties
+ *   * __Shared Memory Name__ Name of the shared memory object holding the ring.
+ *   * __Poll Interval__ Milliseconds between checks for new frames.
+ *   * __Compute Value Range__ Scan each volume frame for its value range.
+ */
+
+/**
+ * \class SharedMemorySource
+ * \brief Source of volumes and images written to shared memory by another process
+ * A background thread waits for the ring to appear and for new frames to be written. The latest
+ * frame is leased from the ring and set on the outport without copying, and the writer does not
+ * reuse its slot until the data has been released by the network. The frames are mapped
+ * copy-on-write, so edits downstream never reach the ring. A ring is read by one processor at a
+ * time.
+ */
+class IVW_MODULE_PYDATA_API SharedMemorySource : public Processor {
+public:
+    SharedMemorySource();
+    virtual ~SharedMemorySource();
+
+    virtual void process() override;
+
+    virtual const ProcessorInfo getProcessorInfo() const override;
+    static const ProcessorInfo processorInfo_;
+
+private:
+    // Wait for frames on the background thread
+    void poll();
+    // Lease the latest frame of the ring and set it on the outports, on the main thread
+    void publish(std::shared_ptr<pydata::SharedMemoryRing> ring);
+
+    VolumeOutport volumeOutport_;
+    ImageOutport imageOutport_;
+    StringProperty name_;
+    IntProperty pollInterval_;
+    BoolProperty valueRange_;
+
+    std::mutex pollMutex_;
+    std::condition_variable pollCondition_;
+    std::string ringName_;
+    int interval_;
+    bool stop_;
+    bool publishPending_;
+    std::thread pollThread_;
+
+    std::shared_ptr<bool> alive_;
+};
+
+} // namespace
+
+#endif // IVW_SHAREDMEMORYSOURCE_H
@@ -0,0 +1,149 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/processors/volumesequencesourcebuffer.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/memorymappedfile.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/datastructures/volume/volumeram.h>
+
+#include <algorithm>
+
+namespace inviwo {
+
+// The Class Identifier has to be globally unique. Use a reverse DNS naming scheme
+const ProcessorInfo VolumeSequenceSourceBuffer::processorInfo_{
+    "se.lathen.VolumeSequenceSourceBuffer",  // Class identifier
+    "Volume Sequence Source Buffer",         // Display name
+    "Data Input",                           // Category
+    CodeState::Experimental,                // Code state
+    Tags::CPU,                              // Tags
+};
+const ProcessorInfo VolumeSequenceSourceBuffer::getProcessorInfo() const {
+    return processorInfo_;
+}
+
+VolumeSequenceSourceBuffer::VolumeSequenceSourceBuffer()
+    : Processor()
+    , outport_("sequence")
+    , volumeOutport_("volume")
+    , timestep_("timestep", "Timestep", 0, 0, 0)
+    , prefetchSteps_("prefetchSteps", "Prefetch Steps", 2, 0, 16)
+    , prefetch_(false)
+    , shownStep_(std::make_shared<std::atomic<size_t>>(0))
+    , alive_(std::make_shared<bool>(true))
+{
+    addPort(outport_);
+    addPort(volumeOutport_);
+    addProperty(timestep_);
+    addProperty(prefetchSteps_);
+    timestep_.onChange([this]() {
+        updateTimestep();
+        invalidate(InvalidationLevel::InvalidOutput);
+    });
+}
+
+void VolumeSequenceSourceBuffer::process() {}
+
+void VolumeSequenceSourceBuffer::setData(std::shared_ptr<VolumeSequence> sequence, bool prefetch,
+                                         std::shared_ptr<pydata::ScratchMemory> scratch) {
+    // The outport and the network may only be touched from the main thread. Calls from other
+    // threads are queued, and dropped if the processor has been removed in the meantime.
+    if (!pydata::isMainThread()) {
+        std::weak_ptr<bool> alive = alive_;
+        InviwoApplication::getPtr()->dispatchFront([this, alive, sequence, prefetch, scratch]() {
+            if (alive.lock()) setData(sequence, prefetch, scratch);
+        });
+        return;
+    }
+
+    pydata::PhaseTimer timer(pydata::IngestPhase::Handover);
+    sequence_ = sequence;
+    prefetch_ = prefetch;
+    outport_.setData(sequence);
+
+    // Steps are stored one after another. A step spilled while it is being selected is only
+    // read back from the file, so the data stays valid.
+    const size_t steps = sequence ? sequence->size() : 0;
+    stepMemory_.clear();
+    if (scratch && steps > 0) {
+        const size_t stepBytes = scratch->getSize() / steps;
+        auto shownStep = shownStep_;
+        for (size_t i = 0; i < steps; ++i) {
+            stepMemory_.push_back(pydata::MemoryBudget::getPtr().track(
+                stepBytes, [scratch, shownStep, stepBytes, i]() {
+                    if (*shownStep == i)
+                        return false;
+                    scratch->spill(i * stepBytes, stepBytes);
+                    return true;
+                }));
+        }
+    }
+
+    // Keep the timestep if the new sequence is long enough
+    timestep_.setMaxValue(static_cast<int>(std::max<size_t>(steps, 1) - 1));
+    updateTimestep();
+    invalidate(InvalidationLevel::InvalidOutput);
+}
+
+void VolumeSequenceSourceBuffer::updateTimestep() {
+    if (!sequence_ || sequence_->empty()) {
+        volumeOutport_.setData(std::shared_ptr<Volume>());
+        return;
+    }
+
+    const size_t steps = sequence_->size();
+    const size_t timestep = std::min(static_cast<size_t>(timestep_.get()), steps - 1);
+    volumeOutport_.setData((*sequence_)[timestep]);
+    *shownStep_ = timestep;
+    if (!stepMemory_.empty())
+        stepMemory_[timestep]->touch();
+
+    // Playback usually moves forward and wraps around at the end
+    const size_t count =
+        prefetch_ ? std::min(static_cast<size_t>(prefetchSteps_.get()), steps - 1) : 0;
+    for (size_t i = 1; i <= count; ++i) {
+        const size_t step = (timestep + i) % steps;
+        auto volumeRAM = (*sequence_)[step]->getRepresentation<VolumeRAM>();
+        const auto dimensions = volumeRAM->getDimensions();
+        pydata::prefetchMemory(volumeRAM->getData(),
+                               glm::compMul(dimensions) * volumeRAM->getDataFormat()->getSize());
+        if (!stepMemory_.empty())
+            stepMemory_[step]->touch();
+    }
+
+    // Spilling writes to the scratch file, which is kept off the main thread
+    if (!stepMemory_.empty()) {
+        InviwoApplication::getPtr()->dispatchPool(
+            []() { pydata::MemoryBudget::getPtr().enforce(); });
+    }
+}
+
+} // namespace
@@ -0,0 +1,110 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_VOLUMESEQUENCESOURCEBUFFER_H
+#define IVW_VOLUMESEQUENCESOURCEBUFFER_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/processors/processor.h>
+#include <inviwo/core/properties/ordinalproperty.h>
+#include <inviwo/core/ports/volumeport.h>
+#include <modules/pydata/util/memorybudget.h>
+
+#include <atomic>
+
+namespace inviwo {
+
+/** \docpage{se.lathen.VolumeSequenceSourceBuffer, Volume Sequence Source Buffer}
+ * ![](se.lathen.VolumeSequenceSourceBuffer.png?classIdentifier=se.lathen.VolumeSequenceSourceBuffer)
+ * Outputs a time series of volumes set from Python, see set_volume_sequence and
+ * map_volume_sequence.
+ *
+ * ### Outports
+ *   * __sequence__ All timesteps.
+ *   * __volume__ The selected timestep.
+ *
+ * ### Properties
+ *   * __Timestep__ Index of the timestep on the volume outport.
+ *   * __Prefetch Steps__ Number of upcoming timesteps read ahead when the data is backed by a
+ *     file.
+ *
+ * Copied sequences are placed in a scratch file if there is a memory budget. Timesteps other
+ * than the selected one are then spilled to the file when the budget is exceeded, and read back
+ * when they are shown again.
+ */
+
+/**
+ * \class VolumeSequenceSourceBuffer
+ * \brief Source of a sequence of volumes that share one allocation
+ * The volumes of the sequence borrow consecutive parts of one arena, which is kept alive by
+ * their representations. Switching timesteps only sets another volume on the outport.
+ */
+class IVW_MODULE_PYDATA_API VolumeSequenceSourceBuffer : public Processor {
+public:
+    VolumeSequenceSourceBuffer();
+    virtual ~VolumeSequenceSourceBuffer() = default;
+
+    virtual void process() override;
+
+    virtual const ProcessorInfo getProcessorInfo() const override;
+    static const ProcessorInfo processorInfo_;
+
+    /**
+     * Set the sequence and invalidate the network. May be called from any thread, the data is
+     * handed over on the main thread. If prefetch is set, upcoming timesteps are read ahead of
+     * playback, which only has an effect on data backed by a file. If the sequence is stored in
+     * scratch memory, each step is counted against the memory budget and may be spilled.
+     */
+    void setData(std::shared_ptr<VolumeSequence> sequence, bool prefetch,
+                 std::shared_ptr<pydata::ScratchMemory> scratch = nullptr);
+
+private:
+    // Set the selected timestep on the volume outport and read ahead the following ones
+    void updateTimestep();
+
+    VolumeSequenceOutport outport_;
+    VolumeOutport volumeOutport_;
+    IntProperty timestep_;
+    IntProperty prefetchSteps_;
+
+    // Only used on the main thread
+    std::shared_ptr<VolumeSequence> sequence_;
+    bool prefetch_;
+    std::vector<std::shared_ptr<pydata::MemoryEntry>> stepMemory_;
+
+    // Timestep on the volume outport, which the budget does not spill
+    std::shared_ptr<std::atomic<size_t>> shownStep_;
+
+    std::shared_ptr<bool> alive_;
+};
+
+} // namespace
+
+#endif // IVW_VOLUMESEQUENCESOURCEBUFFER_H
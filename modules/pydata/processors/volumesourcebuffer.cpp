@@ -28,9 +28,54 @@
  *********************************************************************************/
 
 #include <modules/pydata/processors/volumesourcebuffer.h>
+#include <modules/pydata/datastructures/volumerambuffer.h>
+#include <modules/pydata/util/downsample.h>
+#include <modules/pydata/util/gradient.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/datastructures/volume/volumeram.h>
+#include <inviwo/core/metadata/metadata.h>
+
+#include <algorithm>
+#include <cstring>
 
 namespace inviwo {
 
+namespace {
+
+// Return the source downsampled by factor as a new volume with the given matrices and data
+// mapping. Only the memory of the source is read. The level is counted against the memory
+// budget for as long as it is alive, which may drop it through the function made by getRelease.
+pydata::Pyramid<Volume>::Source downsampleVolume(
+    const pydata::Pyramid<Volume>::Source& source, size_t factor, pydata::DownsampleMode mode,
+    const DataFormatBase* format, const mat4& modelMatrix, const mat4& worldMatrix,
+    const DataMapper& dataMap, std::function<std::function<bool()>(const Volume*)> getRelease) {
+    auto dimensions = pydata::getDownsampledDimensions(source.dimensions, factor);
+    auto& budget = pydata::MemoryBudget::getPtr();
+    auto memory = budget.allocate(glm::compMul(dimensions) * format->getSize());
+    auto levelRAM = createVolumeRAMBuffer(dimensions, format, memory->getData(), memory);
+    if (!levelRAM)
+        throw Exception("Cannot allocate volume buffer", IvwContextCustom("downsampleVolume"));
+    budget.enforce();
+    pydata::downsample(source.memory, source.dimensions, memory->getData(), format, factor, mode);
+
+    auto level = std::make_shared<Volume>(levelRAM);
+    level->setModelMatrix(modelMatrix);
+    level->setWorldMatrix(worldMatrix);
+    level->dataMap_ = dataMap;
+    memory->setRelease(getRelease(level.get()));
+    return {level, memory->getData(), dimensions};
+}
+
+// Return the slope of the mapping from stored data to values
+double getValueScale(const DataMapper& dataMap) {
+    const double dataExtent = dataMap.dataRange.y - dataMap.dataRange.x;
+    return dataExtent > 0.0 ? (dataMap.valueRange.y - dataMap.valueRange.x) / dataExtent : 1.0;
+}
+
+} // namespace
+
 // The Class Identifier has to be globally unique. Use a reverse DNS naming scheme
 const ProcessorInfo VolumeSourceBuffer::processorInfo_{
     "se.lathen.VolumeSourceBuffer",      // Class identifier
@@ -46,16 +91,423 @@ const ProcessorInfo VolumeSourceBuffer::getProcessorInfo() const {
 VolumeSourceBuffer::VolumeSourceBuffer()
     : Processor()
     , outport_("outport")
+    , pyramidOutport_("pyramid")
+    , gradientOutport_("gradient")
+    , gradientMagnitudeOutport_("gradientMagnitude")
+    , poolSize_("poolSize", "Buffer Pool Size", 2, 0, 8)
+    , pyramidLevels_("pyramidLevels", "Pyramid Levels", 1, 1, 8)
+    , pyramidLevel_("pyramidLevel", "Output Level", 0, 0, 7)
+    , pyramidMode_("pyramidMode", "Downsampling")
+    , progressive_("progressive", "Coarsest Level First", true)
+    , coalesce_("coalesce", "Keep Latest Frame Only", false)
+    , dirtyOffset_(0)
+    , dirtyExtent_(0)
+    , dirtyRegionConsumed_(true)
+    , dataVersion_(0)
+    , gradientVersion_(0)
+    , gradientMagnitudeVersion_(0)
+    , unsupportedGradientFormat_(nullptr)
+    , handoverPending_(false)
+    , pyramidDropped_(false)
+    , readers_(std::make_shared<std::atomic<size_t>>(0))
+    , frames_(std::make_shared<pydata::FrameTracker>())
+    , handovers_([this](Frame data, size_t frame) { handOver(data.first, data.second, frame); })
+    , pool_(std::make_shared<pydata::DataPool<Volume>>(static_cast<size_t>(poolSize_.get())))
+    , alive_(std::make_shared<bool>(true))
 {
     addPort(outport_);
+    addPort(pyramidOutport_);
+    addPort(gradientOutport_);
+    addPort(gradientMagnitudeOutport_);
+    addProperty(poolSize_);
+    poolSize_.onChange([this]() { pool_->setSize(static_cast<size_t>(poolSize_.get())); });
+
+    pyramidMode_.addOption("box", "Box", static_cast<int>(pydata::DownsampleMode::Box));
+    pyramidMode_.addOption("max", "Max", static_cast<int>(pydata::DownsampleMode::Max));
+    pyramidMode_.setSelectedIndex(0);
+    pyramidMode_.setCurrentStateAsDefault();
+    addProperty(pyramidLevels_);
+    addProperty(pyramidLevel_);
+    addProperty(pyramidMode_);
+    addProperty(progressive_);
+    pyramidLevels_.onChange([this]() { buildPyramid(); });
+    pyramidMode_.onChange([this]() { buildPyramid(); });
+    progressive_.onChange([this]() { buildPyramid(); });
+    pyramidLevel_.onChange([this]() { updatePyramidOutport(); });
+
+    addProperty(coalesce_);
+    coalesce_.onChange([this]() { handovers_.setCoalescing(coalesce_.get()); });
 }
+
+VolumeSourceBuffer::~VolumeSourceBuffer() { frames_->close(); }
     
 void VolumeSourceBuffer::process() {
+    // Consumers have seen the dirty region, the next update starts a new one
+    dirtyRegionConsumed_ = true;
+
+    if (handoverPending_) {
+        pydata::IngestStats::getPtr().record(pydata::IngestPhase::Evaluate,
+                                             std::chrono::steady_clock::now() - handoverTime_);
+        handoverPending_ = false;
+    }
+    frames_->consume();
+
+    // Derived data is computed once per version, however many consumers there are. Data
+    // dropped by the memory budget is computed again once it is needed.
+    if (pyramidDropped_)
+        updatePyramidOutport();
+    updateGradients();
+}
+
+void VolumeSourceBuffer::setData(std::shared_ptr<Volume> volume,
+                                 std::shared_ptr<const pydata::ValueStats> stats) {
+    // The outport and the network may only be touched from the main thread
+    handovers_.push(Frame(std::move(volume), std::move(stats)), frames_->submit());
 }
 
-void VolumeSourceBuffer::setData(std::shared_ptr<Volume> volume) {
+void VolumeSourceBuffer::handOver(std::shared_ptr<Volume> volume,
+                                  std::shared_ptr<const pydata::ValueStats> stats, size_t frame) {
+    // A volume that was overtaken by a newer one is not set on the outport
+    if (!frames_->handOver(frame)) {
+        pydata::IngestStats::getPtr().addDropped();
+        return;
+    }
+
+    pydata::PhaseTimer timer(pydata::IngestPhase::Handover);
+    {
+        std::lock_guard<std::mutex> lock(volumeMutex_);
+        volume_ = volume;
+        valueStats_ = stats;
+    }
+    readers_ = std::make_shared<std::atomic<size_t>>(0);
+    dirtyRegionConsumed_ = true;
+    setDirtyRegion(size3_t(0), volume ? volume->getDimensions() : size3_t(0));
+    ++dataVersion_;
+
     outport_.setData(volume);
+    buildPyramid();
     invalidate(InvalidationLevel::InvalidOutput);
+    handoverTime_ = std::chrono::steady_clock::now();
+    handoverPending_ = true;
+    // Nothing evaluates the processor without a connected outport, nobody would consume the frame
+    if (!outport_.isConnected())
+        frames_->consume();
+}
+
+std::shared_ptr<Volume> VolumeSourceBuffer::getVolume() const {
+    std::lock_guard<std::mutex> lock(volumeMutex_);
+    return volume_;
+}
+
+std::shared_ptr<const pydata::ValueStats> VolumeSourceBuffer::getValueStats() const {
+    std::lock_guard<std::mutex> lock(volumeMutex_);
+    return valueStats_;
+}
+
+void VolumeSourceBuffer::updateRegion(const size3_t& offset, const size3_t& extent,
+                                      const dvec2& range, std::function<void(VolumeRAM*)> write) {
+    if (!pydata::isMainThread()) {
+        std::weak_ptr<bool> alive = alive_;
+        InviwoApplication::getPtr()->dispatchFront([this, alive, offset, extent, range, write]() {
+            if (alive.lock()) updateRegion(offset, extent, range, write);
+        });
+        return;
+    }
+
+    // The volume may have been replaced since the region was validated
+    auto volume = getWritableVolume();
+    if (!volume) {
+        LogWarn("No volume to update, the region is dropped");
+        return;
+    }
+    try {
+        write(volume->getEditableRepresentation<VolumeRAM>());
+    } catch (const std::exception& e) {
+        LogWarn("Region update dropped: " << e.what());
+        return;
+    }
+
+    // Stored values keep their mapping to values when the data range grows
+    auto& dataMap = volume->dataMap_;
+    const double scale = getValueScale(dataMap);
+    const double valueOffset = dataMap.valueRange.x - dataMap.dataRange.x * scale;
+    dataMap.dataRange = dvec2(std::min(dataMap.dataRange.x, range.x),
+                              std::max(dataMap.dataRange.y, range.y));
+    dataMap.valueRange = dataMap.dataRange * scale + valueOffset;
+    {
+        std::lock_guard<std::mutex> lock(volumeMutex_);
+        valueStats_ = nullptr;
+    }
+
+    if (dirtyRegionConsumed_) {
+        setDirtyRegion(offset, extent);
+    } else {
+        auto lower = glm::min(dirtyOffset_, offset);
+        auto upper = glm::max(dirtyOffset_ + dirtyExtent_, offset + extent);
+        setDirtyRegion(lower, upper - lower);
+    }
+    dirtyRegionConsumed_ = false;
+    ++dataVersion_;
+
+    buildPyramid();
+    invalidate(InvalidationLevel::InvalidOutput);
+}
+
+void VolumeSourceBuffer::setDirtyRegion(const size3_t& offset, const size3_t& extent) {
+    dirtyOffset_ = offset;
+    dirtyExtent_ = extent;
+    if (auto volume = getVolume()) {
+        volume->setMetaData<IntVec3MetaData>("dirtyRegionOffset", ivec3(offset));
+        volume->setMetaData<IntVec3MetaData>("dirtyRegionExtent", ivec3(extent));
+    }
+}
+
+std::shared_ptr<Volume> VolumeSourceBuffer::getWritableVolume() {
+    auto volume = getVolume();
+    if (!volume)
+        return nullptr;
+    // Jobs still reading the data in place must not see the write, they get to finish on the
+    // data they started with
+    if (readers_->load(std::memory_order_acquire) == 0 && pool_->isAllocated(volume))
+        return volume;
+
+    auto copy = getPooledVolume(volume->getDimensions(), volume->getDataFormat());
+    auto volumeRAM = volume->getRepresentation<VolumeRAM>();
+    const size_t bytes = glm::compMul(volume->getDimensions()) * volume->getDataFormat()->getSize();
+    pydata::IngestStats::getPtr().addBytesCopied(bytes);
+    std::memcpy(copy->getEditableRepresentation<VolumeRAM>()->getData(), volumeRAM->getData(),
+                bytes);
+    copy->setModelMatrix(volume->getModelMatrix());
+    copy->setWorldMatrix(volume->getWorldMatrix());
+    copy->dataMap_ = volume->dataMap_;
+    {
+        std::lock_guard<std::mutex> lock(volumeMutex_);
+        volume_ = copy;
+    }
+    readers_ = std::make_shared<std::atomic<size_t>>(0);
+    outport_.setData(copy);
+    return copy;
+}
+
+std::shared_ptr<void> VolumeSourceBuffer::readLease() {
+    auto readers = readers_;
+    readers->fetch_add(1, std::memory_order_relaxed);
+    return std::shared_ptr<void>(nullptr, [readers](void*) {
+        readers->fetch_sub(1, std::memory_order_release);
+    });
+}
+
+void VolumeSourceBuffer::buildPyramid() {
+    auto volume = getVolume();
+    levels_.assign(1, volume);
+    pyramidDropped_ = false;
+    const size_t count = static_cast<size_t>(pyramidLevels_.get());
+    if (!volume || count < 2) {
+        pyramid_.cancel();
+        updatePyramidOutport();
+        return;
+    }
+
+    // Everything read from the volume is gathered here, on the main thread. Getting the RAM
+    // representation may require a download from the GPU.
+    levels_.resize(count);
+    const pydata::Pyramid<Volume>::Source level0{
+        volume, volume->getRepresentation<VolumeRAM>()->getData(), volume->getDimensions()};
+    const auto format = volume->getDataFormat();
+    const auto modelMatrix = volume->getModelMatrix();
+    const auto worldMatrix = volume->getWorldMatrix();
+    const auto dataMap = volume->dataMap_;
+    auto mode = static_cast<pydata::DownsampleMode>(pyramidMode_.get());
+    std::weak_ptr<bool> alive = alive_;
+    auto getRelease = [this, alive](const Volume* level) {
+        return releaseDerived(this, alive, level);
+    };
+    auto downsample = [=](const pydata::Pyramid<Volume>::Source& source, size_t factor) {
+        return downsampleVolume(source, factor, mode, format, modelMatrix, worldMatrix, dataMap,
+                                getRelease);
+    };
+
+    // Finished levels are handed over on the main thread, unless a newer build has started
+    auto receive = [this](pydata::Pyramid<Volume>::Levels levels) {
+        levels_ = levels;
+        updatePyramidOutport();
+        invalidate(InvalidationLevel::InvalidOutput);
+    };
+    auto publish = pyramid_.publishOnMainThread(alive, receive);
+
+    pyramid_.build(level0, readLease(), count, progressive_.get(), downsample, publish);
+    updatePyramidOutport();
+}
+
+void VolumeSourceBuffer::updatePyramidOutport() {
+    if (levels_.empty())
+        return;
+    const auto selected = std::min(static_cast<size_t>(pyramidLevel_.get()), levels_.size() - 1);
+    if (pyramidDropped_ && !levels_[selected] && pyramidOutport_.isConnected()) {
+        buildPyramid();
+        return;
+    }
+
+    // Finer levels are only shown if there is nothing else to show
+    if (auto level = pydata::Pyramid<Volume>::getShownLevel(levels_, selected,
+                                                            !pyramidOutport_.hasData()))
+        pyramidOutport_.setData(level);
+}
+
+void VolumeSourceBuffer::updateGradients() {
+    const bool gradient = gradientOutport_.isConnected() && gradientVersion_ != dataVersion_;
+    const bool magnitude =
+        gradientMagnitudeOutport_.isConnected() && gradientMagnitudeVersion_ != dataVersion_;
+    if (!gradient && !magnitude)
+        return;
+    if (gradient) gradientVersion_ = dataVersion_;
+    if (magnitude) gradientMagnitudeVersion_ = dataVersion_;
+
+    auto volume = getVolume();
+    if (volume && !pydata::isGradientSupported(volume->getDataFormat())) {
+        if (unsupportedGradientFormat_ != volume->getDataFormat()) {
+            unsupportedGradientFormat_ = volume->getDataFormat();
+            LogWarn("Gradients are not computed for " << volume->getDataFormat()->getString()
+                                                      << " volumes");
+        }
+        volume = nullptr;
+    }
+    if (!volume) {
+        if (gradient) gradientOutport_.setData(std::shared_ptr<Volume>());
+        if (magnitude) gradientMagnitudeOutport_.setData(std::shared_ptr<Volume>());
+        return;
+    }
+
+    // Everything read from the volume and the processor is gathered here, on the main thread.
+    // Getting the RAM representation may require a download from the GPU.
+    const auto dimensions = volume->getDimensions();
+    const auto format = volume->getDataFormat();
+    const void* data = volume->getRepresentation<VolumeRAM>()->getData();
+    const mat3 basis = volume->getBasis();
+    const vec3 spacing(glm::length(basis[0]) / dimensions.x, glm::length(basis[1]) / dimensions.y,
+                       glm::length(basis[2]) / dimensions.z);
+    const auto scale = static_cast<float>(getValueScale(volume->dataMap_));
+    const auto modelMatrix = volume->getModelMatrix();
+    const auto worldMatrix = volume->getWorldMatrix();
+    const size_t version = dataVersion_;
+    std::weak_ptr<bool> alive = alive_;
+    auto lease = readLease();
+
+    // Both are computed in one pass over the data, and shared by all consumers. The volume is
+    // kept alive by the job, and the lease keeps region updates from writing into it while it
+    // is read. Results for data that changed meanwhile are dropped.
+    InviwoApplication::getPtr()->dispatchPool([this, alive, volume, lease, data, dimensions,
+                                               format, spacing, scale, modelMatrix, worldMatrix,
+                                               version, gradient, magnitude]() mutable {
+        std::shared_ptr<Volume> gradientVolume;
+        std::shared_ptr<Volume> magnitudeVolume;
+        try {
+            const size_t voxels = glm::compMul(dimensions);
+            auto& budget = pydata::MemoryBudget::getPtr();
+            auto gradientMemory = gradient ? budget.allocate(voxels * sizeof(vec3)) : nullptr;
+            auto magnitudeMemory = magnitude ? budget.allocate(voxels * sizeof(float)) : nullptr;
+            const double maxMagnitude = pydata::computeGradient(
+                data, dimensions, format, spacing,
+                gradient ? static_cast<vec3*>(gradientMemory->getData()) : nullptr,
+                magnitude ? static_cast<float*>(magnitudeMemory->getData()) : nullptr, scale);
+
+            auto derive = [&](std::shared_ptr<pydata::MemoryAllocation> memory,
+                              const DataFormatBase* derivedFormat, const dvec2& range) {
+                auto derivedRAM =
+                    createVolumeRAMBuffer(dimensions, derivedFormat, memory->getData(), memory);
+                auto derived = std::make_shared<Volume>(derivedRAM);
+                derived->setModelMatrix(modelMatrix);
+                derived->setWorldMatrix(worldMatrix);
+                derived->dataMap_.dataRange = range;
+                derived->dataMap_.valueRange = range;
+                memory->setRelease(releaseDerived(this, alive, derived.get()));
+                return derived;
+            };
+            if (gradient) {
+                gradientVolume = derive(gradientMemory, DataVec3Float32::get(),
+                                        dvec2(-maxMagnitude, maxMagnitude));
+            }
+            if (magnitude) {
+                magnitudeVolume =
+                    derive(magnitudeMemory, DataFloat32::get(), dvec2(0, maxMagnitude));
+            }
+            budget.enforce();
+        } catch (const std::exception& e) {
+            LogWarnCustom("VolumeSourceBuffer", "Cannot compute gradients: " << e.what());
+        }
+        lease.reset();
+        pydata::releaseOnMainThread(std::move(volume));
+        if (!gradientVolume && !magnitudeVolume)
+            return;
+
+        InviwoApplication::getPtr()->dispatchFront(
+            [this, alive, version, gradientVolume, magnitudeVolume]() {
+                if (!alive.lock() || version != dataVersion_) return;
+                if (gradientVolume) gradientOutport_.setData(gradientVolume);
+                if (magnitudeVolume) gradientMagnitudeOutport_.setData(magnitudeVolume);
+                invalidate(InvalidationLevel::InvalidOutput);
+            });
+    });
+}
+
+std::shared_ptr<Volume> VolumeSourceBuffer::getPooledVolume(const size3_t& dimensions,
+                                                            const DataFormatBase* format) {
+    auto matches = [&](const Volume& volume) {
+        return volume.getDimensions() == dimensions && volume.getDataFormat() == format;
+    };
+    auto create = [&](std::shared_ptr<pydata::MemoryAllocation> memory) {
+        auto volumeRAM = createVolumeRAMBuffer(dimensions, format, memory->getData(), memory);
+        return volumeRAM ? std::make_shared<Volume>(volumeRAM) : nullptr;
+    };
+    auto volume = pool_->get(glm::compMul(dimensions) * format->getSize(), matches, create);
+    // A reused volume may still carry the data mapping of the previous frame
+    volume->dataMap_.initWithFormat(format);
+    return volume;
+}
+
+std::function<bool()> VolumeSourceBuffer::releaseDerived(VolumeSourceBuffer* processor,
+                                                         std::weak_ptr<bool> alive,
+                                                         const Volume* key) {
+    return [processor, alive, key]() {
+        // The processor and its outports may only be touched from the main thread
+        if (!pydata::isMainThread()) {
+            pydata::MemoryBudget::getPtr().enforceOnMainThread();
+            return false;
+        }
+        return alive.lock() && processor->dropDerived(key);
+    };
+}
+
+bool VolumeSourceBuffer::dropDerived(const Volume* key) {
+    auto shows = [key](const VolumeOutport& port) {
+        return port.hasData() && port.getData().get() == key;
+    };
+    // Data on a connected outport is in use
+    for (auto port : {&pyramidOutport_, &gradientOutport_, &gradientMagnitudeOutport_}) {
+        if (port->isConnected() && shows(*port))
+            return false;
+    }
+
+    std::shared_ptr<const Volume> derived = pydata::Pyramid<Volume>::takeLevel(levels_, key);
+    if (derived)
+        pyramidDropped_ = true;
+    if (shows(pyramidOutport_)) {
+        derived = pyramidOutport_.getData();
+        pyramidOutport_.setData(std::shared_ptr<Volume>());
+    }
+    if (shows(gradientOutport_)) {
+        derived = gradientOutport_.getData();
+        gradientOutport_.setData(std::shared_ptr<Volume>());
+        gradientVersion_ = 0;
+    }
+    if (shows(gradientMagnitudeOutport_)) {
+        derived = gradientMagnitudeOutport_.getData();
+        gradientMagnitudeOutport_.setData(std::shared_ptr<Volume>());
+        gradientMagnitudeVersion_ = 0;
+    }
+
+    // Jobs building the pyramid or consumers may still hold the data, it is freed with them
+    return derived && derived.use_count() == 1;
 }
 
 } // namespace
@@ -33,7 +33,21 @@
 #include <modules/pydata/pydatamoduledefine.h>
 #include <inviwo/core/common/inviwo.h>
 #include <inviwo/core/processors/processor.h>
+#include <inviwo/core/properties/boolproperty.h>
+#include <inviwo/core/properties/optionproperty.h>
+#include <inviwo/core/properties/ordinalproperty.h>
 #include <inviwo/core/ports/volumeport.h>
+#include <inviwo/core/datastructures/volume/volumeram.h>
+#include <modules/pydata/util/datapool.h>
+#include <modules/pydata/util/frametracker.h>
+#include <modules/pydata/util/handoverqueue.h>
+#include <modules/pydata/util/pyramid.h>
+#include <modules/pydata/util/valuestats.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
 
 namespace inviwo {
 
@@ -61,17 +75,144 @@ namespace inviwo {
 class IVW_MODULE_PYDATA_API VolumeSourceBuffer : public Processor { 
 public:
     VolumeSourceBuffer();
-    virtual ~VolumeSourceBuffer() = default;
+    virtual ~VolumeSourceBuffer();
      
     virtual void process() override;
 
     virtual const ProcessorInfo getProcessorInfo() const override;
     static const ProcessorInfo processorInfo_;
 
-    void setData(std::shared_ptr<Volume> volume);
+    /**
+     * Set the data of the outport and invalidate the network. May be called from any thread,
+     * the data is handed over on the main thread. Value statistics computed while the volume was
+     * created are kept along with it. If coalescing is on, a volume still waiting for the main
+     * thread is replaced and dropped, which returns its buffer to the pool.
+     */
+    void setData(std::shared_ptr<Volume> volume,
+                 std::shared_ptr<const pydata::ValueStats> stats = nullptr);
+
+    /**
+     * Return a volume of the given dimensions and format to be filled through its editable RAM
+     * representation and passed to setData. Volumes that are no longer referenced outside the
+     * pool are reused, so streaming frames of the same size does not allocate once the pool is
+     * warm. The buffers are counted against the memory budget, which drops free volumes from
+     * the pool when it is exceeded. May be called from any thread.
+     */
+    std::shared_ptr<Volume> getPooledVolume(const size3_t& dimensions,
+                                            const DataFormatBase* format);
+
+    /**
+     * Return the volume most recently passed to setData, or nullptr. May be called from any
+     * thread.
+     */
+    std::shared_ptr<Volume> getVolume() const;
+
+    /**
+     * Return the value statistics of the current volume, or nullptr if none were computed.
+     * May be called from any thread.
+     */
+    std::shared_ptr<const pydata::ValueStats> getValueStats() const;
+
+    /**
+     * Write a region of the current volume, given in voxels, and invalidate the network. The
+     * write function is called on the main thread with the RAM representation of the volume and
+     * may throw if the volume no longer matches, in which case the update is dropped with a
+     * warning. Volumes with data the processor did not allocate, e.g. borrowed or mapped ones,
+     * or that are still read by pyramid or gradient jobs are copied before they are written to.
+     * The data range is widened to the given range of the region and the value statistics are
+     * dropped. Regions updated between two evaluations are merged, and the bounding box is
+     * stored in the "dirtyRegionOffset" and "dirtyRegionExtent" meta data of the volume so
+     * consumers can update incrementally. May be called from any thread.
+     */
+    void updateRegion(const size3_t& offset, const size3_t& extent, const dvec2& range,
+                      std::function<void(VolumeRAM*)> write);
+
+    /**
+     * Return the tracker of the frames set and consumed by the network. It outlives the
+     * processor, waiting threads are woken up when the processor is removed. Frames handed over
+     * while the outport is not connected are consumed right away.
+     */
+    std::shared_ptr<pydata::FrameTracker> getFrameTracker() const { return frames_; }
 
 private:
+    // Set the data on the outport, on the main thread
+    void handOver(std::shared_ptr<Volume> volume, std::shared_ptr<const pydata::ValueStats> stats,
+                  size_t frame);
+
+    void setDirtyRegion(const size3_t& offset, const size3_t& extent);
+
+    // Return the current volume if its data was allocated by getPooledVolume and no job reads it,
+    // otherwise replace it with such a copy on the outport
+    std::shared_ptr<Volume> getWritableVolume();
+
+    // Return a lease counting a job on the thread pool as a reader of the data of the current
+    // volume until it is released. Region updates write into a copy while there are readers.
+    std::shared_ptr<void> readLease();
+
+    // Start building the pyramid of the current volume, or drop it if only one level is used
+    void buildPyramid();
+    // Set the selected pyramid level, or the nearest coarser one that is done, on the outport
+    void updatePyramidOutport();
+    // Start computing the gradients of the current volume on the thread pool for the connected
+    // outports, unless they are already requested for the current data version. The results are
+    // handed over on the main thread if the data has not changed in the meantime.
+    void updateGradients();
+
     VolumeOutport outport_;
+    VolumeOutport pyramidOutport_;
+    VolumeOutport gradientOutport_;
+    VolumeOutport gradientMagnitudeOutport_;
+    IntProperty poolSize_;
+    IntProperty pyramidLevels_;
+    IntProperty pyramidLevel_;
+    OptionPropertyInt pyramidMode_;
+    BoolProperty progressive_;
+    BoolProperty coalesce_;
+
+    mutable std::mutex volumeMutex_;
+    std::shared_ptr<Volume> volume_;
+    std::shared_ptr<const pydata::ValueStats> valueStats_;
+    size3_t dirtyOffset_;
+    size3_t dirtyExtent_;
+    bool dirtyRegionConsumed_;
+
+    // Version of the data, bumped whenever it is set or updated, and the versions the gradient
+    // outports were computed for. Only used on the main thread.
+    size_t dataVersion_;
+    size_t gradientVersion_;
+    size_t gradientMagnitudeVersion_;
+    // Format last warned about as not supported by the gradients, only used on the main thread
+    const DataFormatBase* unsupportedGradientFormat_;
+
+    // Time of the last handover not yet seen by process, only used on the main thread
+    std::chrono::steady_clock::time_point handoverTime_;
+    bool handoverPending_;
+
+    // A pyramid level was dropped by the memory budget, the pyramid is built again if the
+    // selected level is missing. Only used on the main thread.
+    bool pyramidDropped_;
+
+    // Jobs reading the data of the current volume in place, see readLease. Replaced along with
+    // the volume, only used on the main thread.
+    std::shared_ptr<std::atomic<size_t>> readers_;
+
+    // Levels of the current volume, only used on the main thread
+    pydata::Pyramid<Volume> pyramid_;
+    pydata::Pyramid<Volume>::Levels levels_;
+
+    using Frame = std::pair<std::shared_ptr<Volume>, std::shared_ptr<const pydata::ValueStats>>;
+    std::shared_ptr<pydata::FrameTracker> frames_;
+    pydata::HandoverQueue<Frame> handovers_;
+
+    // Pyramid levels and gradients may be dropped by the memory budget. It is left to the main
+    // thread, and they are only dropped if no connected outport shows them.
+    static std::function<bool()> releaseDerived(VolumeSourceBuffer* processor,
+                                                std::weak_ptr<bool> alive, const Volume* key);
+    // Drop the derived volume, return true if it is freed. Only called on the main thread.
+    bool dropDerived(const Volume* key);
+
+    std::shared_ptr<pydata::DataPool<Volume>> pool_;
+    std::shared_ptr<bool> alive_;
 };
 
 } // namespace
@@ -1,162 +1,919 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
 #include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/network/networklock.h>
 #include <inviwo/core/network/processornetwork.h>
+#include <inviwo/core/ports/imageport.h>
+#include <inviwo/core/ports/volumeport.h>
 #include <inviwo/core/datastructures/image/layerramprecision.h>
 #include <inviwo/core/datastructures/volume/volumeramprecision.h>
 #include <modules/pydata/processors/imagesourcebuffer.h>
+#include <modules/pydata/processors/meshsourcebuffer.h>
+#include <modules/pydata/processors/volumesequencesourcebuffer.h>
 #include <modules/pydata/processors/volumesourcebuffer.h>
+#include <modules/pydata/util/bufferformat.h>
+#include <modules/pydata/util/frametracker.h>
+#include <modules/pydata/util/ingest.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/memorybudget.h>
+#include <modules/pydata/util/parallel.h>
+#include <modules/pydata/util/processorhandle.h>
+#include <modules/pydata/util/stridedcopy.h>
+#include <modules/pydata/util/valuestats.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <mutex>
 
 namespace py = pybind11;
 using namespace inviwo;
 
-// Return a processor from the network in the Inviwo application
+// Return the handle of a processor, one handle is shared per identifier so that it is registered
+// with the network once. Handles whose processor has been removed, or was never found, are
+// evicted on the next call. The map is never destroyed, since the handles may only be destroyed
+// while the application is alive.
 template <typename T>
-T* getProcessor(std::string identifer) {
-    auto inviwoApp = InviwoApplication::getPtr();
-    if (!inviwoApp)
-        throw std::runtime_error("Cannot get reference to Inviwo application");
-
-    auto network = inviwoApp->getProcessorNetwork();
-    auto processor = network->getProcessorByIdentifier(identifer);
-    if (!processor)
-        throw std::runtime_error("Cannot find processor " + identifer);
-
-    auto typedProcessor = dynamic_cast<T*>(processor);
-    if (!typedProcessor)
-        throw std::runtime_error(identifer + " is not of the correct type");
-
-    return typedProcessor;
-}
-
-// Return the numeric type corresponding to the Python buffer protocol format
-NumericType getNumericType(std::string format) {
-    if (format == py::format_descriptor<float>::format() ||
-        format == py::format_descriptor<double>::format())
-        return NumericType::Float;
-    else if (format == py::format_descriptor<char>::format() ||
-        format == py::format_descriptor<short>::format() ||
-        format == py::format_descriptor<int>::format() ||
-        format == py::format_descriptor<long int>::format())
-        return NumericType::SignedInteger;
-    else if (format == py::format_descriptor<unsigned char>::format() ||
-        format == py::format_descriptor<unsigned short>::format() ||
-        format == py::format_descriptor<unsigned int>::format() ||
-        format == py::format_descriptor<unsigned long int>::format())
-        return NumericType::UnsignedInteger;
-    else
-        throw std::runtime_error("Data type not supported");
-}
+std::shared_ptr<ProcessorHandle<T>> getHandle(const std::string& identifier) {
+    static std::mutex mutex;
+    static auto& handles = *new std::map<std::string, std::shared_ptr<ProcessorHandle<T>>>();
 
-// Return the strides for a packed data array stored in row-major order
-std::vector<size_t> getStrides(const std::vector<size_t>& shape, size_t itemsize) {
-    std::vector<size_t> strides(shape.size());
-    size_t i = shape.size() - 1;
-    strides[i] = itemsize;
-    while (true) {
-        if (i == 0)
-            break;
-        i--;
-        strides[i] = strides[i + 1] * shape[i + 1];
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = handles.begin(); it != handles.end();) {
+        if (it->second->isStale())
+            it = handles.erase(it);
+        else
+            ++it;
     }
+    auto& handle = handles[identifier];
+    if (!handle) handle = std::make_shared<ProcessorHandle<T>>(identifier);
+    return handle;
+}
+
+// Return a processor from the network in the Inviwo application. The processor is resolved on
+// the main thread and is not removed from the network while the lock is held. Must be called
+// without the GIL, see ProcessorHandle::get.
+template <typename T>
+T* getProcessor(const std::string& identifier, typename ProcessorHandle<T>::Lock& lock) {
+    pydata::PhaseTimer timer(pydata::IngestPhase::Lookup);
+    return getHandle<T>(identifier)->get(lock);
+}
+
+// Return the Python buffer protocol format of a data format
+std::string getFormatDescriptor(const DataFormatBase* format) {
+    const size_t bytes = format->getSize() / format->getComponents();
+    return std::string(1, pydata::getFormatCode(format->getNumericType(), bytes));
+}
+
+// Return the byte strides of the buffer, negative strides are stored wrapped in the size_t values
+std::vector<std::ptrdiff_t> getStrides(const py::buffer_info& info) {
+    std::vector<std::ptrdiff_t> strides(info.strides.size());
+    for (size_t i = 0; i < info.strides.size(); ++i)
+        strides[i] = static_cast<std::ptrdiff_t>(info.strides[i]);
     return strides;
 }
 
-void set_image(std::string processorIdentifier, py::buffer b) {
-    py::buffer_info info = b.request();
-    auto imageSource = getProcessor<ImageSourceBuffer>(processorIdentifier);
+// Release a buffer requested by pinBuffer. Taking the GIL on whatever thread drops the last
+// reference could deadlock against a Python thread waiting for a lock held there, so buffers
+// released on other threads are queued to the main thread. Once the interpreter is finalized
+// there is nothing left to release to, and the buffer is leaked.
+void releaseBuffer(py::buffer_info* info) {
+    if (!Py_IsInitialized())
+        return;
+    if (!pydata::isMainThread()) {
+        if (auto inviwoApp = InviwoApplication::getPtr())
+            inviwoApp->dispatchFront([info]() { releaseBuffer(info); });
+        return;
+    }
+    py::gil_scoped_acquire gil;
+    delete info;
+}
+
+// Request the buffer and keep it pinned for as long as the returned object is alive. The object
+// may be released from any thread, see releaseBuffer.
+std::shared_ptr<py::buffer_info> pinBuffer(py::buffer b, bool writable = false) {
+    return std::shared_ptr<py::buffer_info>(new py::buffer_info(b.request(writable)),
+                                            &releaseBuffer);
+}
+
+// Return true if the buffer can be requested writable, e.g. false for read-only NumPy arrays
+bool isWritable(py::buffer b) {
+    Py_buffer view;
+    if (PyObject_GetBuffer(b.ptr(), &view, PyBUF_STRIDES | PyBUF_FORMAT | PyBUF_WRITABLE) != 0) {
+        PyErr_Clear();
+        return false;
+    }
+    PyBuffer_Release(&view);
+    return true;
+}
 
-    // Check the strides
-    auto strides = getStrides(info.shape, info.itemsize);
-    if (info.strides != strides)
-        throw std::runtime_error("Data stride not supported (expects a packed row-major stored buffer)");
+// Describe the buffer for ingest, the view keeps the buffer pinned for as long as it is alive.
+// Buffers that may be borrowed are requested writable if possible, since the representations
+// borrowing them are editable. Read-only buffers are copied instead.
+pydata::BufferView getBufferView(py::buffer b, bool borrow = false) {
+    const bool writable = borrow && isWritable(b);
+    auto pinned = pinBuffer(b, writable);
+    auto bufferFormat = pydata::getBufferFormat(pinned->format);
+    if (bufferFormat.itemsize != pinned->itemsize)
+        throw std::runtime_error("Item size does not match the data type " + pinned->format);
 
-    // Determine the numeric type
-    NumericType type = getNumericType(info.format);
+    pydata::BufferView view;
+    view.data = pinned->ptr;
+    view.type = bufferFormat.type;
+    view.itemsize = pinned->itemsize;
+    view.shape = pinned->shape;
+    view.strides = getStrides(*pinned);
+    view.owner = pinned;
+    view.writable = writable;
+    return view;
+}
 
-    // Determine the number of components
-    size_t components;
-    if (info.ndim < 2 || info.ndim > 3)
-        throw std::runtime_error("Incompatible buffer dimensions (expected 2 or 3)");
-    if (info.ndim == 2)
-        components = 1;
-    else
-        components = info.shape[2];
-
-    if (components > 4)
-        throw std::runtime_error("Too many components (expected maximum 4)");
-
-    // Get the resulting data format
-    auto dataFormat = DataFormatBase::get(type, components, info.itemsize * 8);
-    if (!dataFormat)
-        throw std::runtime_error("Data format not supported");
-
-    // Create the layer RAM representation
-    // Note that the buffer shape is described in matrix notation (rows,columns)
-    // but the layer uses an image notation (width,height) where width = columns and height = rows
-    // The OpenGL coordinate frame (origin in the lower left corner) furthermore renders the
-    // array up-side down, which I'm not yet sure how to handle in a stringent manner
-    auto layerRAM = createLayerRAM(size2_t(info.shape[1], info.shape[0]), LayerType::Color, dataFormat);
-    if (!layerRAM)
-        throw std::runtime_error("Cannot allocate layer buffer");
-
-    auto layerData = layerRAM->getData();
-    memcpy(layerData, info.ptr, info.itemsize*info.size);
-
-    auto layer = std::make_shared<Layer>(layerRAM);
-    auto image = std::make_shared<Image>(layer);
-    imageSource->setData(image);
-}
-
-void set_volume(std::string processorIdentifier, py::buffer b) {
-    py::buffer_info info = b.request();
-    auto volumeSource = getProcessor<VolumeSourceBuffer>(processorIdentifier);
-
-    // Check the strides
-    auto strides = getStrides(info.shape, info.itemsize);
-    if (info.strides != strides)
-        throw std::runtime_error("Data stride not supported (expects a packed row-major stored buffer)");
-
-    // Determine the numeric type
-    NumericType type = getNumericType(info.format);
-
-    // Determine the number of components
-    size_t components;
-    if (info.ndim < 3 || info.ndim > 4)
-        throw std::runtime_error("Incompatible buffer dimensions (expected 3 or 4)");
-    if (info.ndim == 3)
-        components = 1;
+// Return the numeric type and item size of a NumPy data type, e.g. "uint16" or numpy.float32.
+// The type is described by its buffer format code, so it maps to the same types as buffers.
+std::pair<NumericType, size_t> getDataType(py::object dtype) {
+    auto descr = py::module::import("numpy").attr("dtype")(dtype);
+    auto byteOrder = descr.attr("byteorder").cast<std::string>();
+    auto code = descr.attr("char").cast<std::string>();
+    auto itemsize = descr.attr("itemsize").cast<size_t>();
+    // NumPy codes have native sizes whatever the byte order, e.g. "<l" is the size of long, while
+    // a byte order prefix selects standard sizes in buffer formats. Only the order is checked.
+    auto little = py::module::import("sys").attr("byteorder").cast<std::string>() == "little";
+    if ((byteOrder == "<" && !little) || (byteOrder == ">" && little))
+        throw std::runtime_error("Data type must have native byte order");
+    auto bufferFormat = pydata::getBufferFormat(code);
+    if (bufferFormat.itemsize != itemsize)
+        throw std::runtime_error("Item size does not match the data type " + code);
+    return {bufferFormat.type, bufferFormat.itemsize};
+}
+
+// Return the ingest options of a volume, dtype, scale and offset may be None
+pydata::IngestOptions getVolumeOptions(bool copy, bool valueRange, size_t bins, py::object dtype,
+                                       py::object scale, py::object offset) {
+    pydata::IngestOptions options(copy);
+    options.valueRange = valueRange;
+    options.bins = bins;
+    if (!dtype.is_none()) {
+        auto type = getDataType(dtype);
+        options.targetType = type.first;
+        options.targetItemsize = type.second;
+    }
+    if (!scale.is_none() || !offset.is_none()) {
+        options.autoScale = false;
+        options.scale = scale.is_none() ? 1.0 : scale.cast<double>();
+        options.offset = offset.is_none() ? 0.0 : offset.cast<double>();
+    }
+    return options;
+}
+
+void set_image(std::string processorIdentifier, py::buffer b, bool copy) {
+    auto buffer = getBufferView(b, !copy);
+
+    // The buffer stays pinned, so other Python threads may run while the data is copied
+    py::gil_scoped_release release;
+    pydata::setImage(*getHandle<ImageSourceBuffer>(processorIdentifier), buffer,
+                     pydata::IngestOptions(copy));
+}
+
+void set_volume(std::string processorIdentifier, py::buffer b, bool copy, bool valueRange,
+                size_t bins, py::object dtype, py::object scale, py::object offset) {
+    auto buffer = getBufferView(b, !copy);
+    auto options = getVolumeOptions(copy, valueRange, bins, dtype, scale, offset);
+
+    // The buffer stays pinned, so other Python threads may run while the data is copied
+    py::gil_scoped_release release;
+    pydata::setVolume(*getHandle<VolumeSourceBuffer>(processorIdentifier), buffer, options);
+}
+
+// Return the value statistics as a dictionary, or None
+py::object valueStatsToDict(std::shared_ptr<const pydata::ValueStats> stats) {
+    if (!stats)
+        return py::none();
+
+    py::dict result;
+    result["range"] = py::make_tuple(stats->range.x, stats->range.y);
+    if (!stats->histogram.empty()) {
+        result["histogram"] = py::cast(stats->histogram);
+        result["histogram_range"] = py::make_tuple(stats->histogramRange.x, stats->histogramRange.y);
+    }
+    return result;
+}
+
+// Return the value statistics computed when the current volume of the processor was set
+py::object get_value_stats(std::string processorIdentifier) {
+    std::shared_ptr<const pydata::ValueStats> stats;
+    {
+        py::gil_scoped_release release;
+        ProcessorHandle<VolumeSourceBuffer>::Lock lock;
+        stats = getProcessor<VolumeSourceBuffer>(processorIdentifier, lock)->getValueStats();
+    }
+    return valueStatsToDict(stats);
+}
+
+// Return the counters and per-phase latencies of the ingest path as a dictionary
+py::dict get_stats() {
+    auto snapshot = pydata::IngestStats::getPtr().getSnapshot();
+
+    py::dict result;
+    result["images"] = py::int_(snapshot.images);
+    result["volumes"] = py::int_(snapshot.volumes);
+    result["bytes_copied"] = py::int_(snapshot.bytesCopied);
+    result["allocations"] = py::int_(snapshot.allocations);
+    result["pool_reuses"] = py::int_(snapshot.reuses);
+    result["borrowed"] = py::int_(snapshot.borrows);
+    result["dropped"] = py::int_(snapshot.dropped);
+
+    // Times are in seconds. Histogram bin i counts durations in [2^(i-1), 2^i) microseconds.
+    py::dict phases;
+    for (size_t i = 0; i < snapshot.phases.size(); ++i) {
+        const auto& phase = snapshot.phases[i];
+        py::dict item;
+        item["count"] = py::int_(phase.count);
+        item["total"] = py::float_(phase.total);
+        item["mean"] = py::float_(phase.count > 0 ? phase.total / phase.count : 0.0);
+        item["max"] = py::float_(phase.max);
+        item["histogram"] = py::cast(std::vector<size_t>(phase.histogram.begin(),
+                                                         phase.histogram.end()));
+        phases[pydata::getIngestPhaseName(static_cast<pydata::IngestPhase>(i))] = item;
+    }
+    result["phases"] = phases;
+    return result;
+}
+
+// Bytes held by buffers created by the module, see MemoryBudget. Borrowed and mapped data is
+// not counted.
+py::dict get_memory_usage() {
+    auto usage = pydata::MemoryBudget::getPtr().getUsage();
+
+    py::dict result;
+    result["used"] = py::int_(usage.used);
+    result["released"] = py::int_(usage.released);
+    result["limit"] = py::int_(usage.limit);
+    result["excess"] = py::int_(usage.excess);
+    result["entries"] = py::int_(usage.entries);
+    result["evictions"] = py::int_(usage.evictions);
+    return result;
+}
+
+// Set data through a cached processor handle, which is only locked while the data is handed over
+template <typename T>
+using HandleSetter = void (*)(ProcessorHandle<T>&, const pydata::BufferView&,
+                              const pydata::IngestOptions&);
+
+template <typename T>
+void setThroughHandle(ProcessorHandle<T>& handle, py::buffer b,
+                      const pydata::IngestOptions& options, HandleSetter<T> set) {
+    auto buffer = getBufferView(b, !options.copy);
+
+    py::gil_scoped_release release;
+    set(handle, buffer, options);
+}
+
+// Limits the number of asynchronous ingest requests in flight, so that a fast producer blocks
+// instead of piling up pinned buffers
+class InFlightLimit {
+public:
+    InFlightLimit() : max_(2), count_(0) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        available_.wait(lock, [this]() { return count_ < max_; });
+        ++count_;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            --count_;
+        }
+        available_.notify_all();
+    }
+
+    size_t getMax() const { return max_; }
+
+    void setMax(size_t max) {
+        if (max == 0)
+            throw std::runtime_error("At least one request must be allowed in flight");
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            max_ = max;
+        }
+        available_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable available_;
+    size_t max_;
+    size_t count_;
+};
+
+InFlightLimit& getInFlightLimit() {
+    static InFlightLimit limit;
+    return limit;
+}
+
+// Handle to an asynchronous ingest request. The request is done when the data has been created
+// and handed over to the processor, which applies it on the main thread. The future holds the
+// processor handle of the request, the thread pool only holds a weak reference to it.
+class IngestFuture {
+public:
+    IngestFuture(std::shared_future<void> future, std::shared_ptr<void> handle)
+        : future_(std::move(future)), handle_(std::move(handle)) {}
+
+    bool done() const {
+        return future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    // Wait for the request, at most timeout seconds if given. Returns true if it is done.
+    bool wait(py::object timeout) const {
+        py::gil_scoped_release release;
+        if (timeout.is_none()) {
+            future_.wait();
+            return true;
+        }
+        auto duration = std::chrono::duration<double>(timeout.cast<double>());
+        return future_.wait_for(duration) == std::future_status::ready;
+    }
+
+    // Wait for the request and raise the exception it failed with, if any
+    void result() const {
+        wait(py::none());
+        future_.get();
+    }
+
+private:
+    std::shared_future<void> future_;
+    std::shared_ptr<void> handle_;
+};
+
+// Create and hand over the data on the thread pool. The caller blocks while the maximum number
+// of requests are in flight. The handle keeps the processor from being removed while the data is
+// handed over. The job only gets a weak reference, so it never releases the handle. If both the
+// handle and the returned future have been released when the job runs, the request is dropped.
+template <typename T>
+IngestFuture setAsync(std::shared_ptr<ProcessorHandle<T>> handle, py::buffer b,
+                      const pydata::IngestOptions& options, HandleSetter<T> set) {
+    auto buffer = getBufferView(b, !options.copy);
+
+    py::gil_scoped_release release;
+    getInFlightLimit().acquire();
+    std::weak_ptr<ProcessorHandle<T>> weak = handle;
+    auto future = InviwoApplication::getPtr()->dispatchPool([weak, buffer, options, set]() {
+        struct Release {
+            ~Release() { getInFlightLimit().release(); }
+        } release;
+        auto handle = weak.lock();
+        if (!handle) throw std::runtime_error("The processor handle was released");
+        set(*handle, buffer, options);
+    });
+    return IngestFuture(future.share(), handle);
+}
+
+IngestFuture set_image_async(std::string processorIdentifier, py::buffer b, bool copy) {
+    auto handle = getHandle<ImageSourceBuffer>(processorIdentifier);
+    return setAsync(handle, b, pydata::IngestOptions(copy), &pydata::setImage);
+}
+
+IngestFuture set_volume_async(std::string processorIdentifier, py::buffer b, bool copy,
+                              bool valueRange, size_t bins, py::object dtype, py::object scale,
+                              py::object offset) {
+    auto options = getVolumeOptions(copy, valueRange, bins, dtype, scale, offset);
+    auto handle = getHandle<VolumeSourceBuffer>(processorIdentifier);
+    return setAsync(handle, b, options, &pydata::setVolume);
+}
+
+// Seconds wait_consumed waits by default. A frame is only consumed once the processor is
+// processed, which may never happen, for example if the network is invalid.
+const double defaultConsumeTimeout = 10.0;
+
+// Wait until the network has consumed the latest frame set on the processor, at most timeout
+// seconds, or forever if timeout is None. Returns true if it was consumed.
+bool waitConsumed(std::shared_ptr<pydata::FrameTracker> frames, py::object timeout) {
+    // The network is evaluated on the main thread, it cannot consume anything while blocked
+    if (pydata::isMainThread())
+        throw std::runtime_error("Cannot wait for the network on the main thread");
+
+    auto seconds = timeout.is_none() ? -1.0 : timeout.cast<double>();
+    auto duration = std::chrono::duration<double>(seconds);
+    py::gil_scoped_release release;
+    return frames->waitConsumed(0, duration);
+}
+
+bool wait_consumed(std::string processorIdentifier, py::object timeout) {
+    std::shared_ptr<pydata::FrameTracker> frames;
+    {
+        py::gil_scoped_release release;
+        ProcessorHandle<Processor>::Lock lock;
+        auto processor = getProcessor<Processor>(processorIdentifier, lock);
+        if (auto volumeSource = dynamic_cast<VolumeSourceBuffer*>(processor))
+            frames = volumeSource->getFrameTracker();
+        else if (auto imageSource = dynamic_cast<ImageSourceBuffer*>(processor))
+            frames = imageSource->getFrameTracker();
+    }
+    if (!frames)
+        throw std::runtime_error(processorIdentifier + " is not an image or volume source");
+    return waitConsumed(frames, timeout);
+}
+
+// Set a volume backed by a raw file, with the shape given in the index order of set_volume
+void map_volume(std::string processorIdentifier, std::string path, std::vector<size_t> shape,
+                py::object dtype, size_t offset, bool prefetch, bool valueRange, size_t bins) {
+    auto type = getDataType(dtype);
+    pydata::IngestOptions options(false);
+    options.valueRange = valueRange;
+    options.bins = bins;
+
+    py::gil_scoped_release release;
+    pydata::mapVolume(*getHandle<VolumeSourceBuffer>(processorIdentifier), path, type.first,
+                      type.second, shape, offset, prefetch, options);
+}
+
+// Set a sequence from a (steps, rows, columns, slices[, components]) buffer or a list of buffers
+void set_volume_sequence(std::string processorIdentifier, py::object buffers, bool copy,
+                         bool valueRange, size_t bins) {
+    std::vector<pydata::BufferView> views;
+    if (py::isinstance<py::list>(buffers) || py::isinstance<py::tuple>(buffers)) {
+        for (auto item : buffers)
+            views.push_back(getBufferView(item.cast<py::buffer>(), !copy));
+    } else {
+        views.push_back(getBufferView(buffers.cast<py::buffer>(), !copy));
+    }
+    pydata::IngestOptions options(copy);
+    options.valueRange = valueRange;
+    options.bins = bins;
+
+    py::gil_scoped_release release;
+    pydata::setVolumeSequence(*getHandle<VolumeSequenceSourceBuffer>(processorIdentifier), views,
+                              options);
+}
+
+// Set a sequence backed by a raw file, with the shape given in the index order of
+// set_volume_sequence
+void map_volume_sequence(std::string processorIdentifier, std::string path,
+                         std::vector<size_t> shape, py::object dtype, size_t offset,
+                         bool valueRange, size_t bins) {
+    auto type = getDataType(dtype);
+    pydata::IngestOptions options(false);
+    options.valueRange = valueRange;
+    options.bins = bins;
+
+    py::gil_scoped_release release;
+    pydata::mapVolumeSequence(*getHandle<VolumeSequenceSourceBuffer>(processorIdentifier), path,
+                              type.first, type.second, shape, offset, options);
+}
+
+// A volume assembled from chunks, see begin_volume. The handle keeps the processor from being
+// removed while the builder takes a volume from its pool and while the volume is handed over.
+class VolumeStream {
+public:
+    VolumeStream(std::string processorIdentifier, std::vector<size_t> shape, py::object dtype)
+        : handle_(getHandle<VolumeSourceBuffer>(processorIdentifier)) {
+        auto type = getDataType(dtype);
+        py::gil_scoped_release release;
+        ProcessorHandle<VolumeSourceBuffer>::Lock lock;
+        builder_ = std::make_shared<pydata::VolumeBuilder>(handle_->get(lock), type.first,
+                                                           type.second, shape);
+    }
+
+    // Chunks are written without the GIL, so several Python threads may push at once
+    void push(py::buffer chunk, std::vector<size_t> offset) {
+        auto buffer = getBufferView(chunk);
+        py::gil_scoped_release release;
+        builder_->push(buffer, offset);
+    }
+
+    void commit(bool valueRange, size_t bins) {
+        pydata::IngestOptions options;
+        options.valueRange = valueRange;
+        options.bins = bins;
+
+        py::gil_scoped_release release;
+        builder_->commit(*handle_, options);
+    }
+
+    bool committed() const { return builder_->isCommitted(); }
+
+private:
+    std::shared_ptr<ProcessorHandle<VolumeSourceBuffer>> handle_;
+    std::shared_ptr<pydata::VolumeBuilder> builder_;
+};
+
+// Return the mesh buffer type of an attribute name
+BufferType getBufferType(const std::string& name) {
+    if (name == "positions")
+        return BufferType::PositionAttrib;
+    else if (name == "normals")
+        return BufferType::NormalAttrib;
+    else if (name == "colors")
+        return BufferType::ColorAttrib;
+    else if (name == "texcoords")
+        return BufferType::TexcoordAttrib;
+    else if (name == "curvature")
+        return BufferType::CurvatureAttrib;
     else
-        components = info.shape[3];
+        throw std::runtime_error("Unknown attribute " + name +
+                                 " (expected positions, normals, colors, texcoords or curvature)");
+}
+
+// Add the attributes given as keyword arguments, each a (vertices[, components]) buffer
+void addMeshAttributes(std::vector<pydata::MeshAttribute>& attributes, py::kwargs kwargs) {
+    for (auto item : kwargs) {
+        auto type = getBufferType(item.first.cast<std::string>());
+        attributes.emplace_back(type, getBufferView(item.second.cast<py::buffer>()));
+    }
+}
+
+void set_mesh(std::string processorIdentifier, py::buffer positions, py::kwargs kwargs) {
+    std::vector<pydata::MeshAttribute> attributes;
+    attributes.emplace_back(BufferType::PositionAttrib, getBufferView(positions));
+    addMeshAttributes(attributes, kwargs);
 
-    if (components > 4)
-        throw std::runtime_error("Too many components (expected maximum 4)");
+    py::gil_scoped_release release;
+    pydata::setMesh(*getHandle<MeshSourceBuffer>(processorIdentifier), attributes, true);
+}
 
-    // Get the resulting data format
-    auto dataFormat = DataFormatBase::get(type, components, info.itemsize * 8);
-    if (!dataFormat)
-        throw std::runtime_error("Data format not supported");
+void update_mesh(std::string processorIdentifier, py::kwargs kwargs) {
+    std::vector<pydata::MeshAttribute> attributes;
+    addMeshAttributes(attributes, kwargs);
 
-    // Create the volume RAM representation
-    // Note that the buffer shape is described in matrix notation (rows,columns,slices)
-    // but the volume uses an image notation (width,height,slices) where width = columns and height = rows
-    // The OpenGL coordinate frame (origin in the lower left corner) furthermore renders the
-    // array up-side down, which I'm not yet sure how to handle in a stringent manner
-    auto volumeRAM = createVolumeRAM(size3_t(info.shape[1], info.shape[0], info.shape[2]), dataFormat);
-    if (!volumeRAM)
-        throw std::runtime_error("Cannot allocate volume buffer");
+    py::gil_scoped_release release;
+    pydata::setMesh(*getHandle<MeshSourceBuffer>(processorIdentifier), attributes, false);
+}
 
-    auto volumeData = volumeRAM->getData();
-    memcpy(volumeData, info.ptr, info.itemsize*info.size);
+void update_volume_region(std::string processorIdentifier, py::buffer b, std::vector<size_t> offset) {
+    auto buffer = getBufferView(b);
 
-    auto volume = std::make_shared<Volume>(volumeRAM);
-    volumeSource->setData(volume);
+    py::gil_scoped_release release;
+    pydata::updateVolumeRegion(*getHandle<VolumeSourceBuffer>(processorIdentifier), buffer,
+                               offset);
+}
+
+double secondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+// Data staged for several source processors, handed to the network in one go so that it is
+// evaluated once for all of them
+class Batch {
+public:
+    void set_image(std::string processorIdentifier, py::buffer b, bool copy) {
+        auto buffer = getBufferView(b, !copy);
+        py::gil_scoped_release release;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto imageSource = getHandle<ImageSourceBuffer>(processorIdentifier);
+        images_.emplace_back(processorIdentifier, pydata::prepareImage(*imageSource, buffer,
+                                                                       pydata::IngestOptions(copy)));
+        stageTime_ += secondsSince(start);
+    }
+
+    // Takes the options of set_volume, the value statistics are handed over with the volume
+    void set_volume(std::string processorIdentifier, py::buffer b, bool copy, bool valueRange,
+                    size_t bins, py::object dtype, py::object scale, py::object offset) {
+        auto buffer = getBufferView(b, !copy);
+        auto options = getVolumeOptions(copy, valueRange, bins, dtype, scale, offset);
+        py::gil_scoped_release release;
+        auto start = std::chrono::high_resolution_clock::now();
+        auto volumeSource = getHandle<VolumeSourceBuffer>(processorIdentifier);
+        StagedVolume staged;
+        staged.identifier = processorIdentifier;
+        staged.volume = pydata::prepareVolume(*volumeSource, buffer, options, staged.stats);
+        volumes_.push_back(std::move(staged));
+        stageTime_ += secondsSince(start);
+    }
+
+    // Stage the buffer for an image or volume source depending on the type of the processor
+    void set(std::string processorIdentifier, py::buffer b, bool copy) {
+        bool isImage;
+        {
+            py::gil_scoped_release release;
+            ProcessorHandle<Processor>::Lock lock;
+            auto processor = getProcessor<Processor>(processorIdentifier, lock);
+            isImage = dynamic_cast<ImageSourceBuffer*>(processor) != nullptr;
+        }
+        if (isImage)
+            set_image(processorIdentifier, b, copy);
+        else
+            set_volume(processorIdentifier, b, copy, false, 0, py::none(), py::none(),
+                       py::none());
+    }
+
+    void discard() {
+        images_.clear();
+        volumes_.clear();
+        stageTime_ = 0.0;
+    }
+
+    // Hand all staged data to the network while it is locked. The network is evaluated when the
+    // lock is released, that time is recorded per source in the evaluate phase of the ingest stats.
+    // Calls from other threads than the main thread are queued, in which case only the staging
+    // time is reported.
+    py::dict apply() {
+        timings_ = py::dict();
+        timings_["stage"] = py::float_(stageTime_);
+
+        auto images = std::move(images_);
+        auto volumes = std::move(volumes_);
+        discard();
+
+        double applyTime = 0.0;
+        if (pydata::isMainThread()) {
+            py::gil_scoped_release release;
+            applyTime = applyStaged(images, volumes);
+        } else {
+            InviwoApplication::getPtr()->dispatchFront(
+                [images, volumes]() { applyStaged(images, volumes); });
+            timings_["queued"] = py::bool_(true);
+            return timings_;
+        }
+
+        timings_["apply"] = py::float_(applyTime);
+        return timings_;
+    }
+
+    py::dict timings() const { return timings_; }
+
+private:
+    using StagedImages = std::vector<std::pair<std::string, std::shared_ptr<Image>>>;
+    struct StagedVolume {
+        std::string identifier;
+        std::shared_ptr<Volume> volume;
+        std::shared_ptr<const pydata::ValueStats> stats;
+    };
+    using StagedVolumes = std::vector<StagedVolume>;
+
+    // Processors are looked up again, they may have been removed since the data was staged.
+    // Returns the time spent handing over the data, not including the network evaluation.
+    static double applyStaged(const StagedImages& images, const StagedVolumes& volumes) {
+        auto network = InviwoApplication::getPtr()->getProcessorNetwork();
+        auto start = std::chrono::high_resolution_clock::now();
+        NetworkLock lock(network);
+        for (const auto& item : images) {
+            if (auto imageSource = dynamic_cast<ImageSourceBuffer*>(
+                    network->getProcessorByIdentifier(item.first)))
+                imageSource->setData(item.second);
+        }
+        for (const auto& item : volumes) {
+            if (auto volumeSource = dynamic_cast<VolumeSourceBuffer*>(
+                    network->getProcessorByIdentifier(item.identifier)))
+                volumeSource->setData(item.volume, item.stats);
+        }
+        return secondsSince(start);
+    }
+
+    StagedImages images_;
+    StagedVolumes volumes_;
+    double stageTime_ = 0.0;
+    py::dict timings_;
+};
+
+// Set the data of several source processors with a single network evaluation
+py::dict set_many(py::dict buffers, bool copy) {
+    Batch batch;
+    for (auto item : buffers)
+        batch.set(item.first.cast<std::string>(), item.second.cast<py::buffer>(), copy);
+    return batch.apply();
+}
+
+// Return the data of an outport of a processor in the network
+template <typename T>
+std::shared_ptr<const T> getOutportData(std::string processorIdentifier, std::string portIdentifier) {
+    py::gil_scoped_release release;
+    ProcessorHandle<Processor>::Lock lock;
+    auto processor = getProcessor<Processor>(processorIdentifier, lock);
+    auto outport = dynamic_cast<DataOutport<T>*>(processor->getOutport(portIdentifier));
+    if (!outport)
+        throw std::runtime_error(processorIdentifier + "." + portIdentifier + " is not an outport of the correct type");
+
+    auto data = outport->getData();
+    if (!data)
+        throw std::runtime_error(processorIdentifier + "." + portIdentifier + " has no data");
+    return data;
+}
+
+// Return a read-only array referencing the data, which is kept alive by the array. The array
+// aliases the data, nothing is copied.
+py::array makeArray(std::shared_ptr<const void> owner, const void* data,
+                    const DataFormatBase* format, std::vector<size_t> shape) {
+    const size_t itemsize = format->getSize() / format->getComponents();
+    if (format->getComponents() > 1)
+        shape.push_back(format->getComponents());
+
+    auto strides = pydata::getPackedStrides(shape, itemsize);
+    py::capsule base(new std::shared_ptr<const void>(std::move(owner)), [](PyObject* capsule) {
+        delete static_cast<std::shared_ptr<const void>*>(PyCapsule_GetPointer(capsule, nullptr));
+    });
+    py::array array(py::dtype(getFormatDescriptor(format)), shape,
+                    std::vector<size_t>(strides.begin(), strides.end()), data, base);
+    array.attr("flags").attr("writeable") = py::bool_(false);
+    return array;
+}
+
+py::array get_layer(std::string processorIdentifier, std::string portIdentifier, std::string type,
+                    size_t index) {
+    auto image = getOutportData<Image>(processorIdentifier, portIdentifier);
+
+    const Layer* layer = nullptr;
+    if (type == "color") {
+        if (index >= image->getNumberOfColorLayers())
+            throw std::runtime_error("Color layer index out of range");
+        layer = image->getColorLayer(index);
+    } else if (type == "depth") {
+        layer = image->getDepthLayer();
+    } else if (type == "picking") {
+        layer = image->getPickingLayer();
+    } else {
+        throw std::runtime_error("Unknown layer type " + type + " (expected color, depth or picking)");
+    }
+    if (!layer)
+        throw std::runtime_error("Image has no " + type + " layer");
+
+    // Getting the RAM representation may require a download from the GPU, which is done on
+    // the main thread where the OpenGL context is current
+    const LayerRAM* layerRAM;
+    {
+        py::gil_scoped_release release;
+        layerRAM = pydata::invokeOnMainThread([layer]() {
+            return layer->getRepresentation<LayerRAM>();
+        });
+    }
+
+    // The inverse of the dimension mapping in set_image
+    auto dimensions = layerRAM->getDimensions();
+    return makeArray(image, layerRAM->getData(), layerRAM->getDataFormat(),
+                     {dimensions.y, dimensions.x});
+}
+
+py::array get_image(std::string processorIdentifier, std::string portIdentifier) {
+    return get_layer(processorIdentifier, portIdentifier, "color", 0);
+}
+
+py::array get_volume(std::string processorIdentifier, std::string portIdentifier) {
+    auto volume = getOutportData<Volume>(processorIdentifier, portIdentifier);
+
+    // Getting the RAM representation may require a download from the GPU, which is done on
+    // the main thread where the OpenGL context is current
+    const VolumeRAM* volumeRAM;
+    {
+        py::gil_scoped_release release;
+        volumeRAM = pydata::invokeOnMainThread([volume]() {
+            return volume->getRepresentation<VolumeRAM>();
+        });
+    }
+
+    // The inverse of the dimension mapping in set_volume
+    auto dimensions = volumeRAM->getDimensions();
+    return makeArray(volume, volumeRAM->getData(), volumeRAM->getDataFormat(),
+                     {dimensions.y, dimensions.x, dimensions.z});
 }
 
 PYBIND11_PLUGIN(inviwo_pydata) {
     py::module m("inviwo_pydata");
 
-    m.def("set_image", &set_image);
-    m.def("set_volume", &set_volume);
+    m.def("set_image", &set_image, py::arg("processor"), py::arg("buffer"), py::arg("copy") = true);
+    m.def("set_volume", &set_volume, py::arg("processor"), py::arg("buffer"), py::arg("copy") = true,
+          py::arg("value_range") = false, py::arg("bins") = 0, py::arg("dtype") = py::none(),
+          py::arg("scale") = py::none(), py::arg("offset") = py::none());
+    m.def("get_value_stats", &get_value_stats, py::arg("processor"));
+    m.def("get_stats", &get_stats);
+    m.def("reset_stats", []() { pydata::IngestStats::getPtr().reset(); });
+    m.def("get_memory_usage", &get_memory_usage);
+
+    m.def("set_image_async", &set_image_async, py::arg("processor"), py::arg("buffer"),
+          py::arg("copy") = true);
+    m.def("set_volume_async", &set_volume_async, py::arg("processor"), py::arg("buffer"),
+          py::arg("copy") = true, py::arg("value_range") = false, py::arg("bins") = 0,
+          py::arg("dtype") = py::none(), py::arg("scale") = py::none(),
+          py::arg("offset") = py::none());
+    m.def("get_max_in_flight", []() { return getInFlightLimit().getMax(); });
+    m.def("set_max_in_flight", [](size_t max) { getInFlightLimit().setMax(max); }, py::arg("max"));
+    const char* consumeNote =
+        "Wait until the network has consumed the latest frame, at most timeout seconds or forever "
+        "if timeout is None. Returns false on timeout. Frames set on a source whose outport is not "
+        "connected count as consumed when they are handed over.";
+    m.def("wait_consumed", &wait_consumed, consumeNote, py::arg("processor"),
+          py::arg("timeout") = defaultConsumeTimeout);
+    py::class_<IngestFuture>(m, "IngestFuture")
+        .def("done", &IngestFuture::done)
+        .def("wait", &IngestFuture::wait, py::arg("timeout") = py::none())
+        .def("result", &IngestFuture::result);
+
+    py::class_<ProcessorHandle<ImageSourceBuffer>, std::shared_ptr<ProcessorHandle<ImageSourceBuffer>>>(m, "ImageSource")
+        .def(py::init<std::string>(), py::arg("processor"))
+        .def_property_readonly("identifier", &ProcessorHandle<ImageSourceBuffer>::getIdentifier)
+        .def("set", [](ProcessorHandle<ImageSourceBuffer>& handle, py::buffer b, bool copy) {
+            setThroughHandle(handle, b, pydata::IngestOptions(copy), &pydata::setImage);
+        }, py::arg("buffer"), py::arg("copy") = true)
+        .def("set_async", [](std::shared_ptr<ProcessorHandle<ImageSourceBuffer>> handle,
+                             py::buffer b, bool copy) {
+            return setAsync(handle, b, pydata::IngestOptions(copy), &pydata::setImage);
+        }, py::arg("buffer"), py::arg("copy") = true)
+        .def("wait_consumed", [](ProcessorHandle<ImageSourceBuffer>& handle, py::object timeout) {
+            std::shared_ptr<pydata::FrameTracker> frames;
+            {
+                py::gil_scoped_release release;
+                ProcessorHandle<ImageSourceBuffer>::Lock lock;
+                frames = handle.get(lock)->getFrameTracker();
+            }
+            return waitConsumed(frames, timeout);
+        }, consumeNote, py::arg("timeout") = defaultConsumeTimeout);
+    py::class_<ProcessorHandle<VolumeSourceBuffer>, std::shared_ptr<ProcessorHandle<VolumeSourceBuffer>>>(m, "VolumeSource")
+        .def(py::init<std::string>(), py::arg("processor"))
+        .def_property_readonly("identifier", &ProcessorHandle<VolumeSourceBuffer>::getIdentifier)
+        .def("set", [](ProcessorHandle<VolumeSourceBuffer>& handle, py::buffer b, bool copy,
+                       bool valueRange, size_t bins, py::object dtype, py::object scale,
+                       py::object offset) {
+            auto options = getVolumeOptions(copy, valueRange, bins, dtype, scale, offset);
+            setThroughHandle(handle, b, options, &pydata::setVolume);
+        }, py::arg("buffer"), py::arg("copy") = true, py::arg("value_range") = false,
+           py::arg("bins") = 0, py::arg("dtype") = py::none(), py::arg("scale") = py::none(),
+           py::arg("offset") = py::none())
+        .def("set_async", [](std::shared_ptr<ProcessorHandle<VolumeSourceBuffer>> handle,
+                             py::buffer b, bool copy, bool valueRange, size_t bins,
+                             py::object dtype, py::object scale, py::object offset) {
+            auto options = getVolumeOptions(copy, valueRange, bins, dtype, scale, offset);
+            return setAsync(handle, b, options, &pydata::setVolume);
+        }, py::arg("buffer"), py::arg("copy") = true, py::arg("value_range") = false,
+           py::arg("bins") = 0, py::arg("dtype") = py::none(), py::arg("scale") = py::none(),
+           py::arg("offset") = py::none())
+        .def("wait_consumed", [](ProcessorHandle<VolumeSourceBuffer>& handle, py::object timeout) {
+            std::shared_ptr<pydata::FrameTracker> frames;
+            {
+                py::gil_scoped_release release;
+                ProcessorHandle<VolumeSourceBuffer>::Lock lock;
+                frames = handle.get(lock)->getFrameTracker();
+            }
+            return waitConsumed(frames, timeout);
+        }, consumeNote, py::arg("timeout") = defaultConsumeTimeout)
+        .def_property_readonly("value_stats", [](ProcessorHandle<VolumeSourceBuffer>& handle) {
+            std::shared_ptr<const pydata::ValueStats> stats;
+            {
+                // The handle is not locked with the GIL held, see ProcessorHandle::get
+                py::gil_scoped_release release;
+                ProcessorHandle<VolumeSourceBuffer>::Lock lock;
+                stats = handle.get(lock)->getValueStats();
+            }
+            return valueStatsToDict(stats);
+        })
+        .def("update_region", [](ProcessorHandle<VolumeSourceBuffer>& handle, py::buffer b,
+                                 std::vector<size_t> offset) {
+            auto buffer = getBufferView(b);
+            py::gil_scoped_release release;
+            pydata::updateVolumeRegion(handle, buffer, offset);
+        }, py::arg("buffer"), py::arg("offset"));
+
+    m.def("map_volume", &map_volume, py::arg("processor"), py::arg("path"), py::arg("shape"),
+          py::arg("dtype"), py::arg("offset") = 0, py::arg("prefetch") = false,
+          py::arg("value_range") = false, py::arg("bins") = 0);
+    m.def("set_volume_sequence", &set_volume_sequence, py::arg("processor"), py::arg("buffers"),
+          py::arg("copy") = true, py::arg("value_range") = false, py::arg("bins") = 0);
+    m.def("map_volume_sequence", &map_volume_sequence, py::arg("processor"), py::arg("path"),
+          py::arg("shape"), py::arg("dtype"), py::arg("offset") = 0,
+          py::arg("value_range") = false, py::arg("bins") = 0);
+    py::class_<VolumeStream>(m, "VolumeBuilder")
+        .def("push", &VolumeStream::push, py::arg("chunk"), py::arg("offset"))
+        .def("commit", &VolumeStream::commit, py::arg("value_range") = false, py::arg("bins") = 0)
+        .def_property_readonly("committed", &VolumeStream::committed)
+        .def("__enter__", [](VolumeStream& stream) -> VolumeStream& { return stream; },
+             py::return_value_policy::reference)
+        .def("__exit__", [](VolumeStream& stream, py::object type, py::object, py::object) {
+            if (type.is_none() && !stream.committed())
+                stream.commit(false, 0);
+        });
+    m.def("begin_volume", [](std::string processor, std::vector<size_t> shape, py::object dtype) {
+        return VolumeStream(processor, shape, dtype);
+    }, py::arg("processor"), py::arg("shape"), py::arg("dtype"));
+    m.def("set_mesh", &set_mesh, py::arg("processor"), py::arg("positions"));
+    m.def("update_mesh", &update_mesh, py::arg("processor"));
+    m.def("update_volume_region", &update_volume_region, py::arg("processor"), py::arg("buffer"),
+          py::arg("offset"));
+    m.def("set_many", &set_many, py::arg("buffers"), py::arg("copy") = true);
+    py::class_<Batch>(m, "Batch")
+        .def(py::init<>())
+        .def("set_image", &Batch::set_image, py::arg("processor"), py::arg("buffer"), py::arg("copy") = true)
+        .def("set_volume", &Batch::set_volume, py::arg("processor"), py::arg("buffer"),
+             py::arg("copy") = true, py::arg("value_range") = false, py::arg("bins") = 0,
+             py::arg("dtype") = py::none(), py::arg("scale") = py::none(),
+             py::arg("offset") = py::none())
+        .def("set", &Batch::set, py::arg("processor"), py::arg("buffer"), py::arg("copy") = true)
+        .def("apply", &Batch::apply)
+        .def_property_readonly("timings", &Batch::timings)
+        .def("__enter__", [](Batch& batch) -> Batch& { return batch; }, py::return_value_policy::reference)
+        .def("__exit__", [](Batch& batch, py::object type, py::object, py::object) {
+            if (type.is_none())
+                batch.apply();
+            else
+                batch.discard();
+        });
+
+    const char* aliasNote =
+        "The returned read-only array aliases the data of the outport, it is not a copy. The data "
+        "stays alive while the array does, copy the array to modify it.";
+    m.def("get_image", &get_image, aliasNote, py::arg("processor"), py::arg("port"));
+    m.def("get_layer", &get_layer, aliasNote, py::arg("processor"), py::arg("port"),
+          py::arg("type") = "color", py::arg("index") = 0);
+    m.def("get_volume", &get_volume, aliasNote, py::arg("processor"), py::arg("port"));
 
 #ifdef VERSION_INFO
     m.attr("__version__") = py::str(VERSION_INFO);
@@ -28,12 +28,20 @@
  *********************************************************************************/
 
 #include <modules/pydata/pydatamodule.h>
+#include <modules/pydata/pydatasettings.h>
 #include <modules/pydata/processors/imagesourcebuffer.h>
+#include <modules/pydata/processors/meshsourcebuffer.h>
+#include <modules/pydata/processors/sharedmemorysource.h>
+#include <modules/pydata/processors/volumesequencesourcebuffer.h>
 #include <modules/pydata/processors/volumesourcebuffer.h>
+#include <modules/pydata/util/parallel.h>
 
 namespace inviwo {
 
 PyDataModule::PyDataModule(InviwoApplication* app) : InviwoModule(app, "PyData") {   
+    // Data may arrive from any Python thread, but is handed to the network on this one
+    pydata::setMainThread();
+
     // Add a directory to the search path of the Shadermanager
     // ShaderManager::getPtr()->addShaderSearchPath(getPath(ModulePath::GLSL));
 
@@ -41,6 +49,9 @@ PyDataModule::PyDataModule(InviwoApplication* app) : InviwoModule(app, "PyData")
     
     // Processors
     registerProcessor<ImageSourceBuffer>();
+    registerProcessor<MeshSourceBuffer>();
+    registerProcessor<SharedMemorySource>();
+    registerProcessor<VolumeSequenceSourceBuffer>();
     registerProcessor<VolumeSourceBuffer>();
     
     // Properties
@@ -65,7 +76,7 @@ PyDataModule::PyDataModule(InviwoApplication* app) : InviwoModule(app, "PyData")
     
     // Other varius things
     // registerCapabilities(util::make_unique<PyDataCapabilities>());
-    // registerSettings(util::make_unique<PyDataSettings>());
+    registerSettings(util::make_unique<PyDataSettings>());
     // registerMetaData(util::make_unique<PyDataMetaData>());   
     // registerPortInspector("PyDataOutport", "path/workspace.inv");
     // registerProcessorWidget(std::string processorClassName, std::unique_ptr<ProcessorWidget> processorWidget);
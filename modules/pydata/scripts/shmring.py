@@ -0,0 +1,110 @@
+"""
+Writer side of the shared memory ring read by the SharedMemorySource processor of the PyData
+module, for producers that run in a separate Python process. See util/sharedmemoryring.h for the
+layout of the ring.
+
+    ring = ShmRing("inviwo_ring", slots=3, slot_size=64 * 2**20)
+    ring.write(volume)              # (rows, columns, slices[, components]) array
+    ring.write(image, kind=IMAGE)   # (rows, columns[, components]) array
+    ring.close()
+
+Frames are written in place and read by the processor without copying, so the writer never
+overwrites a frame that is still in use. write returns False if no slot became free within the
+timeout, in which case the frame is dropped. A ring is read by one processor at a time, which
+maps each frame copy-on-write, so edits in the network never reach the ring. Requires Python 3.8
+and NumPy.
+"""
+
+import os
+import struct
+import time
+
+import numpy as np
+from multiprocessing import shared_memory
+
+MAGIC = 0x52575649  # "IVWR"
+VERSION = 1
+HEADER = struct.Struct("<IIIIQQQ")
+SLOT = struct.Struct("<QII4Q8s")
+HEADER_SIZE = 64
+SLOT_HEADER_SIZE = 64
+
+VOLUME = 0
+IMAGE = 1
+
+
+def _align(size, alignment=64):
+    return (size + alignment - 1) // alignment * alignment
+
+
+class ShmRing:
+    def __init__(self, name, slots=3, slot_size=64 * 2**20):
+        if slots < 2:
+            raise ValueError("A ring needs at least two slots")
+        self.slots = slots
+        self.slot_size = _align(slot_size)
+        self.data_offset = _align(HEADER_SIZE + slots * SLOT_HEADER_SIZE)
+        self.shm = shared_memory.SharedMemory(
+            name=name, create=True, size=self.data_offset + slots * self.slot_size)
+        self.buf = self.shm.buf
+        HEADER.pack_into(self.buf, 0, MAGIC, VERSION, slots, 0, self.slot_size, 0, 0)
+        self.sequence = 0
+
+    def _field(self, fmt, offset):
+        return struct.unpack_from(fmt, self.buf, offset)[0]
+
+    def _reader_alive(self):
+        # The reader stores its process id, a reader that exited without detaching is ignored
+        pid = self._field("<I", 12)
+        if pid == 0:
+            return False
+        try:
+            os.kill(pid, 0)
+        except ProcessLookupError:
+            return False
+        except PermissionError:
+            pass
+        return True
+
+    def _slot_free(self):
+        # A frame may be written over the slot of frame f - slots once the reader is past it
+        read_sequence = self._field("<Q", 32)
+        return self.sequence < read_sequence + self.slots or not self._reader_alive()
+
+    def write(self, array, kind=None, timeout=0.0):
+        array = np.ascontiguousarray(array, dtype=np.asarray(array).dtype.newbyteorder("="))
+        if kind is None:
+            kind = IMAGE if array.ndim == 2 else VOLUME
+        if array.ndim > 4:
+            raise ValueError("Frames have at most 4 dimensions")
+        if array.nbytes > self.slot_size:
+            raise ValueError("Frame is larger than the slots of the ring")
+
+        deadline = time.monotonic() + timeout
+        while not self._slot_free():
+            if time.monotonic() >= deadline:
+                return False
+            time.sleep(0.0005)
+
+        frame = self.sequence
+        slot = frame % self.slots
+        slot_offset = HEADER_SIZE + slot * SLOT_HEADER_SIZE
+
+        # Odd while the frame is written, the reader skips the slot until it is even again
+        struct.pack_into("<Q", self.buf, slot_offset, 2 * frame + 1)
+        target = np.ndarray(array.shape, array.dtype, buffer=self.buf,
+                            offset=self.data_offset + slot * self.slot_size)
+        target[...] = array
+        shape = list(array.shape) + [0] * (4 - array.ndim)
+        SLOT.pack_into(self.buf, slot_offset, 2 * frame + 1, kind, array.ndim, *shape,
+                       array.dtype.char.encode())
+        struct.pack_into("<Q", self.buf, slot_offset, 2 * frame + 2)
+        struct.pack_into("<Q", self.buf, 24, frame + 1)
+        self.sequence += 1
+        return True
+
+    def close(self, unlink=True):
+        self.buf = None
+        self.shm.close()
+        if unlink:
+            self.shm.unlink()
@@ -0,0 +1,107 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/bufferformat.h>
+
+#include <stdexcept>
+
+namespace inviwo {
+
+TEST(BufferFormat, Codes) {
+    auto half = pydata::getBufferFormat("e");
+    EXPECT_EQ(NumericType::Float, half.type);
+    EXPECT_EQ(2u, half.itemsize);
+
+    auto single = pydata::getBufferFormat("f");
+    EXPECT_EQ(NumericType::Float, single.type);
+    EXPECT_EQ(4u, single.itemsize);
+
+    auto int64 = pydata::getBufferFormat("q");
+    EXPECT_EQ(NumericType::SignedInteger, int64.type);
+    EXPECT_EQ(8u, int64.itemsize);
+
+    auto uint16 = pydata::getBufferFormat("H");
+    EXPECT_EQ(NumericType::UnsignedInteger, uint16.type);
+    EXPECT_EQ(2u, uint16.itemsize);
+
+    // Booleans are read as unsigned bytes
+    auto boolean = pydata::getBufferFormat("?");
+    EXPECT_EQ(NumericType::UnsignedInteger, boolean.type);
+    EXPECT_EQ(1u, boolean.itemsize);
+}
+
+TEST(BufferFormat, ByteOrder) {
+    EXPECT_EQ('d', pydata::getBufferFormat("=d").code);
+    EXPECT_EQ('I', pydata::getBufferFormat("@I").code);
+
+    const std::uint16_t one = 1;
+    const bool little = *reinterpret_cast<const std::uint8_t*>(&one) == 1;
+    EXPECT_EQ('f', pydata::getBufferFormat(little ? "<f" : ">f").code);
+    EXPECT_THROW(pydata::getBufferFormat(little ? ">f" : "<f"), std::runtime_error);
+}
+
+TEST(BufferFormat, StandardSizes) {
+    // A byte order prefix selects standard sizes, where long is always 4 bytes
+    const std::uint16_t one = 1;
+    const bool little = *reinterpret_cast<const std::uint8_t*>(&one) == 1;
+    EXPECT_EQ(4u, pydata::getBufferFormat("=l").itemsize);
+    EXPECT_EQ(4u, pydata::getBufferFormat(little ? "<L" : ">L").itemsize);
+    EXPECT_EQ(NumericType::UnsignedInteger, pydata::getBufferFormat("=L").type);
+    EXPECT_EQ(sizeof(long), pydata::getBufferFormat("l").itemsize);
+    EXPECT_EQ(sizeof(long), pydata::getBufferFormat("@l").itemsize);
+    EXPECT_EQ(8u, pydata::getBufferFormat("=q").itemsize);
+}
+
+TEST(BufferFormat, Unsupported) {
+    EXPECT_THROW(pydata::getBufferFormat(""), std::runtime_error);
+    EXPECT_THROW(pydata::getBufferFormat("x"), std::runtime_error);
+    EXPECT_THROW(pydata::getBufferFormat("ff"), std::runtime_error);
+    EXPECT_THROW(pydata::getBufferFormat("Zf"), std::runtime_error);
+}
+
+TEST(BufferFormat, FormatCodes) {
+    EXPECT_EQ('e', pydata::getFormatCode(NumericType::Float, 2));
+    EXPECT_EQ('d', pydata::getFormatCode(NumericType::Float, 8));
+    EXPECT_EQ('b', pydata::getFormatCode(NumericType::SignedInteger, 1));
+    EXPECT_EQ('B', pydata::getFormatCode(NumericType::UnsignedInteger, 1));
+    EXPECT_THROW(pydata::getFormatCode(NumericType::Float, 16), std::runtime_error);
+
+    for (auto code : {'e', 'f', 'd', 'b', 'h', 'i', 'q', 'B', 'H', 'I', 'Q'}) {
+        auto format = pydata::getBufferFormat(std::string(1, code));
+        auto roundTrip = pydata::getFormatCode(format.type, format.itemsize);
+        EXPECT_EQ(format.itemsize, pydata::getBufferFormat(std::string(1, roundTrip)).itemsize);
+    }
+}
+
+} // namespace
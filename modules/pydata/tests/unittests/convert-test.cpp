@@ -0,0 +1,129 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/stridedcopy.h>
+#include <modules/pydata/util/valuestats.h>
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace inviwo {
+
+TEST(Convert, Targets) {
+    EXPECT_TRUE(pydata::isConversionTarget(NumericType::Float, 4));
+    EXPECT_TRUE(pydata::isConversionTarget(NumericType::Float, 2));
+    EXPECT_TRUE(pydata::isConversionTarget(NumericType::UnsignedInteger, 1));
+    EXPECT_TRUE(pydata::isConversionTarget(NumericType::UnsignedInteger, 2));
+    EXPECT_FALSE(pydata::isConversionTarget(NumericType::Float, 8));
+    EXPECT_FALSE(pydata::isConversionTarget(NumericType::SignedInteger, 4));
+}
+
+TEST(Convert, DoubleToFloatStrided) {
+    // Every other row of a (6, 4) array, read in reverse column order
+    std::vector<double> src(6 * 4);
+    for (size_t i = 0; i < src.size(); ++i) src[i] = 0.5 * static_cast<double>(i) - 3.0;
+    const std::vector<std::ptrdiff_t> strides{2 * 4 * 8, -8};
+    const auto start = src.data() + 3;
+
+    std::vector<float> dst(3 * 4);
+    pydata::convertStrided(start, strides, NumericType::Float, 8, dst.data(), NumericType::Float,
+                           4, {3, 4});
+    for (size_t r = 0; r < 3; ++r) {
+        for (size_t c = 0; c < 4; ++c)
+            EXPECT_EQ(static_cast<float>(src[2 * r * 4 + 3 - c]), dst[r * 4 + c]);
+    }
+}
+
+TEST(Convert, Quantize) {
+    const std::vector<float> src{-10.0f, -9.0f, 0.0f, 500.0f, 600.0f};
+    std::vector<std::uint8_t> dst(src.size());
+
+    // stored = (value - offset) / scale, rounded and clamped
+    pydata::convertStrided(src.data(), {4}, NumericType::Float, 4, dst.data(),
+                           NumericType::UnsignedInteger, 1, {src.size()}, 2.0, -10.0);
+    EXPECT_EQ((std::vector<std::uint8_t>{0, 1, 5, 255, 255}), dst);
+}
+
+TEST(Convert, StatsWhileConverting) {
+    // The visitor sees the converted values, column by column of a (2, 3) array
+    const std::vector<std::int32_t> src{4, -2, 10, 6, 0, 8};
+    const std::vector<std::ptrdiff_t> strides{4, 3 * 4};
+    auto visitor = pydata::ValueStatsVisitor::create(DataUInt8::get(), 0);
+    std::vector<std::uint8_t> dst(src.size());
+    pydata::convertStrided(src.data(), strides, NumericType::SignedInteger, 4, dst.data(),
+                           NumericType::UnsignedInteger, 1, {3, 2}, 2.0, -2.0, visitor.get());
+    EXPECT_EQ((std::vector<std::uint8_t>{3, 4, 0, 1, 6, 5}), dst);
+    auto stats = visitor->finish(dst.data(), dst.size());
+    EXPECT_EQ(0.0, stats.range.x);
+    EXPECT_EQ(6.0, stats.range.y);
+}
+
+TEST(Convert, Half) {
+    const std::vector<float> src{0.0f, 1.0f, -2.5f, 65504.0f, 1e6f, 0.099975586f};
+    std::vector<std::uint16_t> half(src.size());
+    pydata::convertStrided(src.data(), {4}, NumericType::Float, 4, half.data(), NumericType::Float,
+                           2, {src.size()});
+    EXPECT_EQ((std::vector<std::uint16_t>{0x0000, 0x3c00, 0xc100, 0x7bff, 0x7c00, 0x2e66}), half);
+
+    std::vector<float> back(src.size());
+    pydata::convertStrided(half.data(), {2}, NumericType::Float, 2, back.data(), NumericType::Float,
+                           4, {src.size()});
+    EXPECT_EQ(1.0f, back[1]);
+    EXPECT_EQ(-2.5f, back[2]);
+    EXPECT_EQ(65504.0f, back[3]);
+    EXPECT_TRUE(std::isinf(back[4]));
+    EXPECT_EQ(src[5], back[5]);
+}
+
+TEST(Convert, ValueRange) {
+    const std::vector<double> src{3.0, std::numeric_limits<double>::quiet_NaN(), -7.5, 12.0};
+    auto range = pydata::getValueRange(src.data(), {8}, NumericType::Float, 8, {src.size()});
+    EXPECT_EQ(-7.5, range.x);
+    EXPECT_EQ(12.0, range.y);
+
+    // Without any values the range is empty
+    const std::vector<float> nan(3, std::numeric_limits<float>::quiet_NaN());
+    range = pydata::getValueRange(nan.data(), {4}, NumericType::Float, 4, {nan.size()});
+    EXPECT_GT(range.x, range.y);
+
+    // Every other element
+    const std::vector<std::int16_t> ints{5, -300, 42, 7};
+    range = pydata::getValueRange(ints.data(), {2 * 2}, NumericType::SignedInteger, 2, {2});
+    EXPECT_EQ(5.0, range.x);
+    EXPECT_EQ(42.0, range.y);
+}
+
+} // namespace
@@ -0,0 +1,85 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/downsample.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace inviwo {
+
+TEST(Downsample, BoxRoundsIntegersAndClampsBorders) {
+    // A 3x1x1 row, the last block only has one voxel
+    const std::vector<std::uint8_t> src{1, 2, 7};
+    std::vector<std::uint8_t> dst(2);
+    pydata::downsample(src.data(), size3_t(3, 1, 1), dst.data(), DataUInt8::get(), 2,
+                       pydata::DownsampleMode::Box);
+    EXPECT_EQ(2, dst[0]);
+    EXPECT_EQ(7, dst[1]);
+}
+
+TEST(Downsample, MaxOfSignedBlock) {
+    const std::vector<std::int16_t> src{-5, -3, -8, -4, -9, -7, -6, -2};
+    std::vector<std::int16_t> dst(1);
+    pydata::downsample(src.data(), size3_t(2), dst.data(), DataInt16::get(), 2,
+                       pydata::DownsampleMode::Max);
+    EXPECT_EQ(-2, dst[0]);
+}
+
+TEST(Downsample, HalfIsReducedInSinglePrecision) {
+    std::vector<std::uint16_t> src;
+    for (float value : {0.5f, 1.5f, -2.0f, 4.0f, 1.0f, 3.0f, 0.25f, 0.75f})
+        src.push_back(pydata::floatToHalf(value));
+    std::vector<std::uint16_t> dst(2);
+
+    pydata::downsample(src.data(), size3_t(4, 2, 1), dst.data(), DataFloat16::get(), 2,
+                       pydata::DownsampleMode::Box);
+    EXPECT_EQ(1.5f, pydata::halfToFloat(dst[0]));
+    EXPECT_EQ(0.75f, pydata::halfToFloat(dst[1]));
+
+    pydata::downsample(src.data(), size3_t(4, 2, 1), dst.data(), DataFloat16::get(), 2,
+                       pydata::DownsampleMode::Max);
+    EXPECT_EQ(3.0f, pydata::halfToFloat(dst[0]));
+    EXPECT_EQ(4.0f, pydata::halfToFloat(dst[1]));
+}
+
+TEST(Downsample, DimensionsRoundUp) {
+    const auto dimensions = pydata::getDownsampledDimensions(size3_t(5, 4, 1), 2);
+    EXPECT_EQ(3u, dimensions.x);
+    EXPECT_EQ(2u, dimensions.y);
+    EXPECT_EQ(1u, dimensions.z);
+}
+
+} // namespace
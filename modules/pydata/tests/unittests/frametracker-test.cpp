@@ -0,0 +1,113 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/frametracker.h>
+
+#include <thread>
+
+namespace inviwo {
+
+namespace {
+const std::chrono::duration<double> shortWait(0.01);
+const std::chrono::duration<double> forever(-1.0);
+} // namespace
+
+TEST(FrameTracker, Numbering) {
+    pydata::FrameTracker frames;
+    EXPECT_EQ(1u, frames.submit());
+    EXPECT_EQ(2u, frames.submit());
+    EXPECT_EQ(2u, frames.getSubmitted());
+    EXPECT_EQ(0u, frames.getConsumed());
+}
+
+TEST(FrameTracker, ConsumedAfterHandOver) {
+    pydata::FrameTracker frames;
+    const auto frame = frames.submit();
+
+    // Processing without a new frame consumes nothing
+    frames.consume();
+    EXPECT_FALSE(frames.waitConsumed(frame, shortWait));
+
+    frames.handOver(frame);
+    EXPECT_FALSE(frames.waitConsumed(frame, shortWait));
+    frames.consume();
+    EXPECT_TRUE(frames.waitConsumed(frame, shortWait));
+    EXPECT_EQ(frame, frames.getConsumed());
+}
+
+TEST(FrameTracker, NewerFrameConsumesOlder) {
+    pydata::FrameTracker frames;
+    const auto first = frames.submit();
+    const auto second = frames.submit();
+    frames.handOver(second);
+    frames.consume();
+    EXPECT_TRUE(frames.waitConsumed(first, shortWait));
+    EXPECT_TRUE(frames.waitConsumed(0, shortWait));
+}
+
+TEST(FrameTracker, OlderFrameIsDropped) {
+    pydata::FrameTracker frames;
+    const auto first = frames.submit();
+    const auto second = frames.submit();
+    EXPECT_TRUE(frames.handOver(second));
+    EXPECT_FALSE(frames.handOver(first));
+    EXPECT_FALSE(frames.handOver(second));
+    frames.consume();
+    EXPECT_EQ(second, frames.getConsumed());
+}
+
+TEST(FrameTracker, WaitFromOtherThread) {
+    pydata::FrameTracker frames;
+    const auto frame = frames.submit();
+    std::thread network([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        frames.handOver(frame);
+        frames.consume();
+    });
+    EXPECT_TRUE(frames.waitConsumed(0, forever));
+    network.join();
+}
+
+TEST(FrameTracker, CloseWakesWaiters) {
+    pydata::FrameTracker frames;
+    frames.submit();
+    std::thread network([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        frames.close();
+    });
+    EXPECT_FALSE(frames.waitConsumed(0, forever));
+    network.join();
+}
+
+} // namespace
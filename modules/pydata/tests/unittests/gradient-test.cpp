@@ -0,0 +1,152 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/gradient.h>
+
+#include <cmath>
+#include <cstdint>
+
+namespace inviwo {
+
+namespace {
+
+// Values of f = a x + b y + c z at the voxels, in the packed order of a volume
+template <typename T>
+std::vector<T> makeRamp(const size3_t& dimensions, double a, double b, double c, double d) {
+    std::vector<T> data(dimensions.x * dimensions.y * dimensions.z);
+    for (size_t z = 0; z < dimensions.z; ++z) {
+        for (size_t y = 0; y < dimensions.y; ++y) {
+            for (size_t x = 0; x < dimensions.x; ++x) {
+                data[(z * dimensions.y + y) * dimensions.x + x] =
+                    static_cast<T>(a * x + b * y + c * z + d);
+            }
+        }
+    }
+    return data;
+}
+
+} // namespace
+
+TEST(Gradient, Supported) {
+    EXPECT_TRUE(pydata::isGradientSupported(DataFloat32::get()));
+    EXPECT_TRUE(pydata::isGradientSupported(DataUInt8::get()));
+    EXPECT_TRUE(pydata::isGradientSupported(DataFloat16::get()));
+    EXPECT_FALSE(pydata::isGradientSupported(DataVec3Float32::get()));
+}
+
+TEST(Gradient, Ramp) {
+    // Central and one-sided differences are both exact for a linear function, so the gradient
+    // is the same everywhere including the borders
+    const size3_t dimensions(6, 5, 4);
+    const auto data = makeRamp<float>(dimensions, 2.0, -3.0, 0.5, 1.0);
+    const vec3 spacing(0.5f, 1.0f, 2.0f);
+    const size_t voxels = dimensions.x * dimensions.y * dimensions.z;
+    std::vector<vec3> gradient(voxels);
+    std::vector<float> magnitude(voxels);
+
+    const float maxMagnitude = pydata::computeGradient(
+        data.data(), dimensions, DataFloat32::get(), spacing, gradient.data(), magnitude.data());
+
+    const float expected = std::sqrt(4.0f * 4.0f + 3.0f * 3.0f + 0.25f * 0.25f);
+    for (size_t i = 0; i < voxels; ++i) {
+        EXPECT_FLOAT_EQ(4.0f, gradient[i].x);
+        EXPECT_FLOAT_EQ(-3.0f, gradient[i].y);
+        EXPECT_FLOAT_EQ(0.25f, gradient[i].z);
+        EXPECT_FLOAT_EQ(expected, magnitude[i]);
+    }
+    EXPECT_FLOAT_EQ(expected, maxMagnitude);
+}
+
+TEST(Gradient, ScaledQuantizedRamp) {
+    // Quantized data stored as uint8 with the values 0.25 * data - 10, the gradient is that of
+    // the values
+    const size3_t dimensions(8, 3, 2);
+    const auto data = makeRamp<std::uint8_t>(dimensions, 10.0, 4.0, 20.0, 0.0);
+    const size_t voxels = dimensions.x * dimensions.y * dimensions.z;
+    std::vector<vec3> gradient(voxels);
+
+    const float maxMagnitude =
+        pydata::computeGradient(data.data(), dimensions, DataUInt8::get(), vec3(1.0f),
+                                gradient.data(), nullptr, 0.25f);
+    for (size_t i = 0; i < voxels; ++i) {
+        EXPECT_FLOAT_EQ(2.5f, gradient[i].x);
+        EXPECT_FLOAT_EQ(1.0f, gradient[i].y);
+        EXPECT_FLOAT_EQ(5.0f, gradient[i].z);
+    }
+    EXPECT_FLOAT_EQ(std::sqrt(2.5f * 2.5f + 1.0f + 25.0f), maxMagnitude);
+}
+
+TEST(Gradient, HalfRamp) {
+    // Small integers are exact in half precision
+    const size3_t dimensions(4, 3, 2);
+    const auto ramp = makeRamp<float>(dimensions, 2.0, 1.0, -4.0, 8.0);
+    std::vector<std::uint16_t> data;
+    for (auto value : ramp) data.push_back(pydata::floatToHalf(value));
+    const size_t voxels = dimensions.x * dimensions.y * dimensions.z;
+    std::vector<vec3> gradient(voxels);
+
+    const float maxMagnitude = pydata::computeGradient(
+        data.data(), dimensions, DataFloat16::get(), vec3(1.0f), gradient.data(), nullptr);
+    for (size_t i = 0; i < voxels; ++i) {
+        EXPECT_FLOAT_EQ(2.0f, gradient[i].x);
+        EXPECT_FLOAT_EQ(1.0f, gradient[i].y);
+        EXPECT_FLOAT_EQ(-4.0f, gradient[i].z);
+    }
+    EXPECT_FLOAT_EQ(std::sqrt(21.0f), maxMagnitude);
+}
+
+TEST(Gradient, SingleVoxelAxes) {
+    // Axes with a single voxel have no difference
+    const size3_t dimensions(5, 1, 1);
+    const auto data = makeRamp<double>(dimensions, 3.0, 0.0, 0.0, 0.0);
+    std::vector<vec3> gradient(5);
+    pydata::computeGradient(data.data(), dimensions, DataFloat64::get(), vec3(1.0f),
+                            gradient.data(), nullptr);
+    for (const auto& g : gradient) {
+        EXPECT_FLOAT_EQ(3.0f, g.x);
+        EXPECT_EQ(0.0f, g.y);
+        EXPECT_EQ(0.0f, g.z);
+    }
+}
+
+TEST(Gradient, UnsupportedFormat) {
+    std::vector<float> data(8 * 2, 0.0f);
+    std::vector<float> magnitude(8);
+    EXPECT_ANY_THROW(pydata::computeGradient(data.data(), size3_t(2, 2, 2),
+                                             DataVec2Float32::get(), vec3(1.0f), nullptr,
+                                             magnitude.data()));
+}
+
+} // namespace
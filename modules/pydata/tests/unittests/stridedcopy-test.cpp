@@ -0,0 +1,196 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/stridedcopy.h>
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+namespace inviwo {
+
+namespace {
+
+// Bytes of a packed array where every item holds its own index
+std::vector<char> makeIndexed(size_t count, size_t itemsize) {
+    std::vector<char> data(count * itemsize);
+    for (size_t i = 0; i < count; ++i) {
+        const auto value = static_cast<std::uint64_t>(i);
+        std::memcpy(data.data() + i * itemsize, &value, std::min(itemsize, sizeof(value)));
+    }
+    return data;
+}
+
+// Gather the array item by item, the reference for copyStrided
+std::vector<char> gather(const char* src, const std::vector<std::ptrdiff_t>& strides,
+                         const std::vector<size_t>& shape, size_t itemsize) {
+    size_t count = 1;
+    for (auto extent : shape) count *= extent;
+    std::vector<char> result(count * itemsize);
+    for (size_t i = 0; i < count; ++i) {
+        std::ptrdiff_t offset = 0;
+        size_t index = i;
+        for (size_t axis = shape.size(); axis-- > 0;) {
+            offset += static_cast<std::ptrdiff_t>(index % shape[axis]) * strides[axis];
+            index /= shape[axis];
+        }
+        std::memcpy(result.data() + i * itemsize, src + offset, itemsize);
+    }
+    return result;
+}
+
+// Copy into a packed array and compare with the reference
+void expectPackedCopy(const char* src, const std::vector<std::ptrdiff_t>& strides,
+                      const std::vector<size_t>& shape, size_t itemsize) {
+    auto expected = gather(src, strides, shape, itemsize);
+    std::vector<char> result(expected.size());
+    pydata::copyStrided(src, strides, result.data(), pydata::getPackedStrides(shape, itemsize),
+                        shape, itemsize);
+    EXPECT_EQ(expected, result);
+}
+
+// Counts the elements seen by the visitor, in items
+class CountingVisitor : public pydata::CopyVisitor {
+public:
+    CountingVisitor(size_t itemsize) : itemsize_(itemsize), items_(0) {}
+
+    class CountingJob : public Job {
+    public:
+        CountingJob(size_t itemsize) : itemsize(itemsize), items(0) {}
+        virtual void visit(const char*, std::ptrdiff_t, size_t count,
+                           size_t elementSize) override {
+            items += count * elementSize / itemsize;
+        }
+        size_t itemsize;
+        size_t items;
+    };
+
+    virtual std::unique_ptr<Job> beginJob() override {
+        return std::unique_ptr<Job>(new CountingJob(itemsize_));
+    }
+    virtual void endJob(std::unique_ptr<Job> job) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_ += static_cast<CountingJob&>(*job).items;
+    }
+
+    size_t getItems() const { return items_; }
+
+private:
+    size_t itemsize_;
+    std::mutex mutex_;
+    size_t items_;
+};
+
+} // namespace
+
+TEST(StridedCopy, PackedStrides) {
+    EXPECT_EQ((std::vector<std::ptrdiff_t>{24, 8, 4}), pydata::getPackedStrides({5, 3, 2}, 4));
+    EXPECT_EQ((std::vector<std::ptrdiff_t>{2}), pydata::getPackedStrides({7}, 2));
+}
+
+TEST(StridedCopy, Contiguous) {
+    const std::vector<size_t> shape{4, 5, 6};
+    auto src = makeIndexed(4 * 5 * 6, 2);
+    expectPackedCopy(src.data(), pydata::getPackedStrides(shape, 2), shape, 2);
+}
+
+TEST(StridedCopy, NegativeStrides) {
+    const std::vector<size_t> shape{6, 7, 3};
+    auto src = makeIndexed(6 * 7 * 3, 4);
+    auto strides = pydata::getPackedStrides(shape, 4);
+
+    // Reverse the first and last axes, as a[::-1, :, ::-1] in NumPy
+    const char* start = src.data() + (shape[0] - 1) * strides[0] + (shape[2] - 1) * strides[2];
+    strides[0] = -strides[0];
+    strides[2] = -strides[2];
+    expectPackedCopy(start, strides, shape, 4);
+}
+
+TEST(StridedCopy, FortranOrder) {
+    const std::vector<size_t> shape{9, 5, 4};
+    auto src = makeIndexed(9 * 5 * 4, 8);
+    const std::vector<std::ptrdiff_t> strides{8, 9 * 8, 9 * 5 * 8};
+    expectPackedCopy(src.data(), strides, shape, 8);
+}
+
+TEST(StridedCopy, Transposed) {
+    // The transpose of a packed (70, 100) array, large enough for several tiles with a partial
+    // tile at the end
+    auto src = makeIndexed(70 * 100, 4);
+    expectPackedCopy(src.data(), {4, 100 * 4}, {100, 70}, 4);
+
+    auto bytes = makeIndexed(33 * 65, 1);
+    expectPackedCopy(bytes.data(), {1, 65}, {65, 33}, 1);
+}
+
+TEST(StridedCopy, TransposedWithOuterAxis) {
+    const std::vector<size_t> shape{3, 40, 50};
+    auto src = makeIndexed(3 * 40 * 50, 2);
+    const std::vector<std::ptrdiff_t> strides{40 * 50 * 2, 2, 40 * 2};
+    expectPackedCopy(src.data(), strides, shape, 2);
+}
+
+TEST(StridedCopy, MergedAxes) {
+    // Every other row of a packed array, the inner two axes are merged into one element
+    const std::vector<size_t> shape{5, 4, 3};
+    auto src = makeIndexed(10 * 4 * 3, 1);
+    const std::vector<std::ptrdiff_t> strides{2 * 4 * 3, 3, 1};
+    expectPackedCopy(src.data(), strides, shape, 1);
+}
+
+TEST(StridedCopy, EmptyAndSingletonAxes) {
+    auto src = makeIndexed(6, 4);
+    std::vector<char> result(6 * 4, 0);
+    pydata::copyStrided(src.data(), {4, 4}, result.data(), {4, 4}, {0, 6}, 4);
+    EXPECT_EQ(std::vector<char>(6 * 4, 0), result);
+
+    expectPackedCopy(src.data(), {0, 4, 0}, {1, 6, 1}, 4);
+}
+
+TEST(StridedCopy, VisitorSeesEveryItem) {
+    const std::vector<size_t> shape{40, 50};
+    auto src = makeIndexed(40 * 50, 4);
+    std::vector<char> result(src.size());
+    const auto packed = pydata::getPackedStrides(shape, 4);
+
+    CountingVisitor rows(4);
+    pydata::copyStrided(src.data(), packed, result.data(), packed, shape, 4, &rows);
+    EXPECT_EQ(40u * 50u, rows.getItems());
+
+    CountingVisitor tiles(4);
+    pydata::copyStrided(src.data(), {4, 40 * 4}, result.data(), packed, shape, 4, &tiles);
+    EXPECT_EQ(40u * 50u, tiles.getItems());
+}
+
+} // namespace
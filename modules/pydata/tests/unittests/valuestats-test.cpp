@@ -0,0 +1,154 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <warn/push>
+#include <warn/ignore/all>
+#include <gtest/gtest.h>
+#include <warn/pop>
+
+#include <modules/pydata/util/stridedcopy.h>
+#include <modules/pydata/util/valuestats.h>
+
+#include <cstdint>
+#include <limits>
+#include <numeric>
+
+namespace inviwo {
+
+namespace {
+
+// Compute the statistics of packed data while copying it, as done when a volume is set
+template <typename T>
+pydata::ValueStats copyWithStats(const std::vector<T>& src, const DataFormatBase* format,
+                                 size_t bins, dvec2 histogramRange = dvec2(0.0)) {
+    auto visitor = pydata::ValueStatsVisitor::create(format, bins, histogramRange);
+    std::vector<T> dst(src.size());
+    const std::vector<size_t> shape{src.size()};
+    const auto strides = pydata::getPackedStrides(shape, sizeof(T));
+    pydata::copyStrided(src.data(), strides, dst.data(), strides, shape, sizeof(T),
+                        visitor.get());
+    return visitor->finish(dst.data(), dst.size() * sizeof(T));
+}
+
+size_t total(const std::vector<size_t>& histogram) {
+    return std::accumulate(histogram.begin(), histogram.end(), size_t(0));
+}
+
+} // namespace
+
+TEST(ValueStats, FloatRange) {
+    const std::vector<float> data{2.5f, -1.0f, std::numeric_limits<float>::quiet_NaN(), 7.0f};
+    auto stats = copyWithStats(data, DataFloat32::get(), 0);
+    EXPECT_EQ(-1.0, stats.range.x);
+    EXPECT_EQ(7.0, stats.range.y);
+    EXPECT_TRUE(stats.histogram.empty());
+}
+
+TEST(ValueStats, IntegerRange) {
+    const std::vector<std::int16_t> data{-300, 12, 4000, 0};
+    auto stats = copyWithStats(data, DataInt16::get(), 0);
+    EXPECT_EQ(-300.0, stats.range.x);
+    EXPECT_EQ(4000.0, stats.range.y);
+}
+
+TEST(ValueStats, HalfRange) {
+    // 1.0, -2.5, 65504 and NaN as half precision bits
+    const std::vector<std::uint16_t> data{0x3c00, 0xc100, 0x7bff, 0x7e00};
+    auto stats = copyWithStats(data, DataFloat16::get(), 4);
+    EXPECT_EQ(-2.5, stats.range.x);
+    EXPECT_EQ(65504.0, stats.range.y);
+    EXPECT_EQ(3u, total(stats.histogram));
+}
+
+TEST(ValueStats, EightBitHistogram) {
+    // The histogram covers the whole type with one bin per value, filled in a single pass
+    std::vector<std::uint8_t> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<std::uint8_t>(i % 200 + 10);
+    auto stats = copyWithStats(data, DataUInt8::get(), 256);
+    EXPECT_EQ(10.0, stats.range.x);
+    EXPECT_EQ(209.0, stats.range.y);
+    EXPECT_EQ(0.0, stats.histogramRange.x);
+    EXPECT_EQ(256.0, stats.histogramRange.y);
+    ASSERT_EQ(256u, stats.histogram.size());
+    EXPECT_EQ(0u, stats.histogram[9]);
+    EXPECT_EQ(5u, stats.histogram[10]);
+    EXPECT_EQ(5u, stats.histogram[209]);
+    EXPECT_EQ(0u, stats.histogram[210]);
+    EXPECT_EQ(data.size(), total(stats.histogram));
+}
+
+TEST(ValueStats, HistogramOverValueRange) {
+    // Without a given range the bins span the values, the maximum goes into the last bin
+    const std::vector<double> data{0.0, 0.5, 1.0, 2.0, 3.9, 4.0};
+    auto stats = copyWithStats(data, DataFloat64::get(), 4);
+    EXPECT_EQ(0.0, stats.histogramRange.x);
+    EXPECT_EQ(4.0, stats.histogramRange.y);
+    EXPECT_EQ((std::vector<size_t>{2, 1, 1, 2}), stats.histogram);
+}
+
+TEST(ValueStats, HistogramOverGivenRange) {
+    // Values outside the given range are not counted
+    const std::vector<float> data{-5.0f, 0.0f, 2.0f, 9.0f, 10.0f, 11.0f};
+    auto stats = copyWithStats(data, DataFloat32::get(), 5, dvec2(0.0, 10.0));
+    EXPECT_EQ(-5.0, stats.range.x);
+    EXPECT_EQ(11.0, stats.range.y);
+    EXPECT_EQ((std::vector<size_t>{1, 1, 0, 0, 2}), stats.histogram);
+}
+
+TEST(ValueStats, ConstantData) {
+    // An empty value range is widened so that all values fall into the histogram
+    const std::vector<float> data(10, 3.0f);
+    auto stats = copyWithStats(data, DataFloat32::get(), 3);
+    EXPECT_EQ(3.0, stats.range.x);
+    EXPECT_EQ(3.0, stats.range.y);
+    EXPECT_EQ(2.5, stats.histogramRange.x);
+    EXPECT_EQ(3.5, stats.histogramRange.y);
+    EXPECT_EQ((std::vector<size_t>{0, 10, 0}), stats.histogram);
+}
+
+TEST(ValueStats, Scan) {
+    // Borrowed data is scanned instead of visited while copying
+    const std::vector<std::uint16_t> data{100, 7, 65535, 300};
+    auto visitor = pydata::ValueStatsVisitor::create(DataUInt16::get(), 2);
+    visitor->scan(data.data(), data.size() * sizeof(std::uint16_t));
+    auto stats = visitor->finish(data.data(), data.size() * sizeof(std::uint16_t));
+    EXPECT_EQ(7.0, stats.range.x);
+    EXPECT_EQ(65535.0, stats.range.y);
+    EXPECT_EQ((std::vector<size_t>{3, 1}), stats.histogram);
+}
+
+TEST(ValueStats, MultipleComponents) {
+    // Statistics are taken over all components
+    const std::vector<float> data{1.0f, -2.0f, 3.0f, 4.0f, 5.0f, -6.0f};
+    auto stats = copyWithStats(data, DataVec3Float32::get(), 0);
+    EXPECT_EQ(-6.0, stats.range.x);
+    EXPECT_EQ(5.0, stats.range.y);
+}
+
+} // namespace
@@ -0,0 +1,147 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/bufferformat.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Native sizes, those of the C types behind the codes, so 'l' is 4 bytes on Windows and 8 bytes
+// elsewhere. Codes that share a type are listed in order of preference when going from type to
+// code.
+constexpr BufferFormat bufferFormats[] = {
+    {'e', NumericType::Float, 2},
+    {'f', NumericType::Float, sizeof(float)},
+    {'d', NumericType::Float, sizeof(double)},
+    {'b', NumericType::SignedInteger, sizeof(signed char)},
+    {'h', NumericType::SignedInteger, sizeof(short)},
+    {'i', NumericType::SignedInteger, sizeof(int)},
+    {'l', NumericType::SignedInteger, sizeof(long)},
+    {'q', NumericType::SignedInteger, sizeof(long long)},
+    {'B', NumericType::UnsignedInteger, sizeof(unsigned char)},
+    {'H', NumericType::UnsignedInteger, sizeof(unsigned short)},
+    {'I', NumericType::UnsignedInteger, sizeof(unsigned int)},
+    {'L', NumericType::UnsignedInteger, sizeof(unsigned long)},
+    {'Q', NumericType::UnsignedInteger, sizeof(unsigned long long)},
+    {'?', NumericType::UnsignedInteger, sizeof(bool)},
+};
+constexpr size_t bufferFormatCount = sizeof(bufferFormats) / sizeof(bufferFormats[0]);
+
+constexpr const BufferFormat* findFormat(char code, size_t i = 0) {
+    return i == bufferFormatCount
+               ? nullptr
+               : bufferFormats[i].code == code ? &bufferFormats[i] : findFormat(code, i + 1);
+}
+
+constexpr const BufferFormat* findFormat(NumericType type, size_t itemsize, size_t i = 0) {
+    return i == bufferFormatCount
+               ? nullptr
+               : bufferFormats[i].type == type && bufferFormats[i].itemsize == itemsize
+                     ? &bufferFormats[i]
+                     : findFormat(type, itemsize, i + 1);
+}
+
+static_assert(findFormat('q')->itemsize == 8, "long long must be 64 bits");
+static_assert(findFormat('h')->itemsize == 2 && findFormat('i')->itemsize == 4 &&
+                  findFormat('?')->itemsize == 1,
+              "Native sizes must match the standard sizes, except for long");
+static_assert(findFormat(NumericType::UnsignedInteger, 1)->code == 'B',
+              "Unsigned bytes must not map to bool");
+
+// Return the standard size of the code, used with the '=', '<', '>' and '!' prefixes. It differs
+// from the native size only for 'l' and 'L', which are always 4 bytes.
+size_t getStandardSize(const BufferFormat& format) {
+    return format.code == 'l' || format.code == 'L' ? 4 : format.itemsize;
+}
+
+bool isLittleEndian() {
+    const std::uint16_t value = 1;
+    return *reinterpret_cast<const std::uint8_t*>(&value) == 1;
+}
+
+} // namespace
+
+BufferFormat getBufferFormat(const std::string& format) {
+    // Skip the byte order. Only '@' and no prefix use native sizes, the others standard sizes.
+    size_t pos = 0;
+    bool standard = false;
+    if (!format.empty()) {
+        switch (format[0]) {
+            case '@':
+                pos = 1;
+                break;
+            case '=':
+                pos = 1;
+                standard = true;
+                break;
+            case '<':
+                if (!isLittleEndian())
+                    throw std::runtime_error("Data type must have native byte order");
+                pos = 1;
+                standard = true;
+                break;
+            case '>':
+            case '!':
+                if (isLittleEndian())
+                    throw std::runtime_error("Data type must have native byte order");
+                pos = 1;
+                standard = true;
+                break;
+            default:
+                break;
+        }
+    }
+
+    const BufferFormat* bufferFormat = nullptr;
+    if (format.size() == pos + 1)
+        bufferFormat = findFormat(format[pos]);
+    if (bufferFormat && standard && getStandardSize(*bufferFormat) != bufferFormat->itemsize)
+        bufferFormat = findFormat(bufferFormat->type, getStandardSize(*bufferFormat));
+    if (!bufferFormat)
+        throw std::runtime_error("Data type not supported: " + format);
+    return *bufferFormat;
+}
+
+char getFormatCode(NumericType type, size_t itemsize) {
+    auto bufferFormat = findFormat(type, itemsize);
+    if (!bufferFormat)
+        throw std::runtime_error("No buffer format for " + std::to_string(itemsize * 8) +
+                                 "-bit components of this type");
+    return bufferFormat->code;
+}
+
+} // namespace
+
+} // namespace
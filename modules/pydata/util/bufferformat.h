@@ -0,0 +1,67 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_BUFFERFORMAT_H
+#define IVW_PYDATA_BUFFERFORMAT_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Component type of a buffer, given by a struct format code of the Python buffer protocol
+ * (PEP 3118) as used by NumPy. Booleans are stored as unsigned bytes and 'e' is a half
+ * precision float.
+ */
+struct IVW_MODULE_PYDATA_API BufferFormat {
+    char code;
+    NumericType type;
+    size_t itemsize;
+};
+
+/**
+ * Return the component type of a buffer format string such as "f" or "<H". Throws if the
+ * format is not a single supported type in native byte order. Codes with a '=', '<', '>' or '!'
+ * prefix have standard sizes, so "<l" is 4 bytes while "l" is the size of long.
+ */
+IVW_MODULE_PYDATA_API BufferFormat getBufferFormat(const std::string& format);
+
+/**
+ * Return the format code of components of the given type, the reverse of getBufferFormat
+ */
+IVW_MODULE_PYDATA_API char getFormatCode(NumericType type, size_t itemsize);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_BUFFERFORMAT_H
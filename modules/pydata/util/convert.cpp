@@ -0,0 +1,364 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Number of elements handled by each parallel job
+constexpr size_t jobElements = 1 << 18;
+
+// The array as rows along its last axis, after merging axes that are contiguous in the source.
+// The destination is packed, so it is contiguous over any merged axes.
+struct Rows {
+    Rows(const std::vector<size_t>& shape, const std::vector<std::ptrdiff_t>& strides)
+        : count(1), length(1), step(0) {
+        for (size_t i = 0; i < shape.size(); ++i) {
+            if (shape[i] == 0) {
+                count = 0;
+                return;
+            }
+            if (shape[i] == 1) continue;
+            const auto extent = static_cast<std::ptrdiff_t>(shape[i]);
+            if (!outerShape.empty() && outerStrides.back() == strides[i] * extent) {
+                outerShape.back() *= shape[i];
+                outerStrides.back() = strides[i];
+            } else {
+                outerShape.push_back(shape[i]);
+                outerStrides.push_back(strides[i]);
+            }
+        }
+
+        // The innermost axis makes up the rows
+        if (!outerShape.empty()) {
+            length = outerShape.back();
+            step = outerStrides.back();
+            outerShape.pop_back();
+            outerStrides.pop_back();
+        }
+        for (auto extent : outerShape)
+            count *= extent;
+    }
+
+    // Source offset in bytes of the first element of the row
+    std::ptrdiff_t getOffset(size_t row) const {
+        std::ptrdiff_t offset = 0;
+        for (size_t i = outerShape.size(); i-- > 0;) {
+            offset += static_cast<std::ptrdiff_t>(row % outerShape[i]) * outerStrides[i];
+            row /= outerShape[i];
+        }
+        return offset;
+    }
+
+    size_t count;
+    size_t length;
+    std::ptrdiff_t step;
+    std::vector<size_t> outerShape;
+    std::vector<std::ptrdiff_t> outerStrides;
+};
+
+// Run job(begin, end) over runs of rows of about jobElements elements in parallel
+template <typename F>
+void forEachRows(const Rows& rows, F job) {
+    const size_t rowsPerJob = std::max<size_t>(1, jobElements / std::max<size_t>(1, rows.length));
+    const size_t jobs = (rows.count + rowsPerJob - 1) / rowsPerJob;
+    parallelFor(jobs, [&](size_t index) {
+        job(index * rowsPerJob, std::min(rows.count, (index + 1) * rowsPerJob));
+    });
+}
+
+// Half precision float, only used to select the kernels reading its bits
+struct Half {};
+
+
+// Read a value of type S from possibly unaligned memory
+template <typename S>
+struct Load {
+    using type = S;
+    static S apply(const char* src) {
+        S value;
+        std::memcpy(&value, src, sizeof(S));
+        return value;
+    }
+};
+
+template <>
+struct Load<Half> {
+    using type = float;
+    static float apply(const char* src) {
+        std::uint16_t bits;
+        std::memcpy(&bits, src, sizeof(bits));
+        return halfToFloat(bits);
+    }
+};
+
+template <typename D>
+D quantize(double value) {
+    const double max = std::numeric_limits<D>::max();
+    // Written so that NaN ends up as 0
+    if (!(value > 0.0)) return 0;
+    if (value >= max) return std::numeric_limits<D>::max();
+    return static_cast<D>(value + 0.5);
+}
+
+enum class Target { Float32, Float16, UInt8, UInt16 };
+
+template <typename S, Target T>
+void convertRow(const char* src, std::ptrdiff_t step, char* dst, size_t count, double factor,
+                double offset) {
+    for (size_t i = 0; i < count; ++i, src += step) {
+        const double value = (static_cast<double>(Load<S>::apply(src)) - offset) * factor;
+        switch (T) {
+            case Target::Float32:
+                reinterpret_cast<float*>(dst)[i] = static_cast<float>(value);
+                break;
+            case Target::Float16:
+                reinterpret_cast<std::uint16_t*>(dst)[i] = floatToHalf(static_cast<float>(value));
+                break;
+            case Target::UInt8:
+                reinterpret_cast<std::uint8_t*>(dst)[i] = quantize<std::uint8_t>(value);
+                break;
+            case Target::UInt16:
+                reinterpret_cast<std::uint16_t*>(dst)[i] = quantize<std::uint16_t>(value);
+                break;
+        }
+    }
+}
+
+template <typename S, Target T>
+void convertT(const char* src, const Rows& rows, char* dst, size_t dstItemsize, double scale,
+              double offset, CopyVisitor* visitor) {
+    const double factor = 1.0 / scale;
+    const size_t rowBytes = rows.length * dstItemsize;
+    forEachRows(rows, [&](size_t begin, size_t end) {
+        auto visit = visitor ? visitor->beginJob() : nullptr;
+        for (size_t row = begin; row < end; ++row) {
+            char* dstRow = dst + row * rowBytes;
+            convertRow<S, T>(src + rows.getOffset(row), rows.step, dstRow, rows.length, factor,
+                             offset);
+            if (visit) visit->visit(dstRow, static_cast<std::ptrdiff_t>(rowBytes), 1, rowBytes);
+        }
+        if (visitor) visitor->endJob(std::move(visit));
+    });
+}
+
+template <typename S>
+void convertFrom(const char* src, const Rows& rows, char* dst, NumericType dstType,
+                 size_t dstItemsize, double scale, double offset, CopyVisitor* visitor) {
+    if (dstType == NumericType::Float && dstItemsize == 4)
+        return convertT<S, Target::Float32>(src, rows, dst, dstItemsize, scale, offset, visitor);
+    if (dstType == NumericType::Float && dstItemsize == 2)
+        return convertT<S, Target::Float16>(src, rows, dst, dstItemsize, scale, offset, visitor);
+    if (dstType == NumericType::UnsignedInteger && dstItemsize == 1)
+        return convertT<S, Target::UInt8>(src, rows, dst, dstItemsize, scale, offset, visitor);
+    if (dstType == NumericType::UnsignedInteger && dstItemsize == 2)
+        return convertT<S, Target::UInt16>(src, rows, dst, dstItemsize, scale, offset, visitor);
+    throw Exception("Conversion target not supported", IvwContextCustom("convertStrided"));
+}
+
+template <typename S>
+dvec2 getValueRangeT(const char* src, const Rows& rows) {
+    std::mutex mutex;
+    double min = std::numeric_limits<double>::max();
+    double max = std::numeric_limits<double>::lowest();
+    forEachRows(rows, [&](size_t begin, size_t end) {
+        using V = typename Load<S>::type;
+        V localMin = std::numeric_limits<V>::max(), localMax = std::numeric_limits<V>::lowest();
+        for (size_t row = begin; row < end; ++row) {
+            const char* data = src + rows.getOffset(row);
+            for (size_t i = 0; i < rows.length; ++i, data += rows.step) {
+                const V value = Load<S>::apply(data);
+                if (value < localMin) localMin = value;
+                if (value > localMax) localMax = value;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        min = std::min(min, static_cast<double>(localMin));
+        max = std::max(max, static_cast<double>(localMax));
+    });
+    return dvec2(min, max);
+}
+
+// Call f with a value of the C++ type matching the numeric type and item size
+template <typename F>
+auto dispatchType(NumericType type, size_t itemsize, F f) -> decltype(f(float())) {
+    switch (type) {
+        case NumericType::Float:
+            if (itemsize == 2) return f(Half());
+            if (itemsize == 4) return f(float());
+            if (itemsize == 8) return f(double());
+            break;
+        case NumericType::SignedInteger:
+            if (itemsize == 1) return f(std::int8_t());
+            if (itemsize == 2) return f(std::int16_t());
+            if (itemsize == 4) return f(std::int32_t());
+            if (itemsize == 8) return f(std::int64_t());
+            break;
+        case NumericType::UnsignedInteger:
+            if (itemsize == 1) return f(std::uint8_t());
+            if (itemsize == 2) return f(std::uint16_t());
+            if (itemsize == 4) return f(std::uint32_t());
+            if (itemsize == 8) return f(std::uint64_t());
+            break;
+        default:
+            break;
+    }
+    throw Exception("Source type not supported", IvwContextCustom("convertStrided"));
+}
+
+struct Convert {
+    template <typename S>
+    void operator()(S) const {
+        convertFrom<S>(src, rows, dst, dstType, dstItemsize, scale, offset, visitor);
+    }
+
+    const char* src;
+    const Rows& rows;
+    char* dst;
+    NumericType dstType;
+    size_t dstItemsize;
+    double scale;
+    double offset;
+    CopyVisitor* visitor;
+};
+
+struct ValueRange {
+    template <typename S>
+    dvec2 operator()(S) const {
+        return getValueRangeT<S>(src, rows);
+    }
+
+    const char* src;
+    const Rows& rows;
+};
+
+} // namespace
+
+float halfToFloat(std::uint16_t half) {
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    std::uint32_t exponent = (half >> 10) & 0x1fu;
+    std::uint32_t mantissa = half & 0x3ffu;
+
+    std::uint32_t bits;
+    if (exponent == 0x1f) {
+        // Infinity or NaN
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    } else if (mantissa == 0) {
+        bits = sign;
+    } else {
+        // Subnormal, normalize the mantissa
+        exponent = 127 - 14;
+        while (!(mantissa & 0x400u)) {
+            mantissa <<= 1;
+            --exponent;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3ffu) << 13);
+    }
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Rounds to nearest even, after "float_to_half_fast3_rtne" by F. Giesen
+std::uint16_t floatToHalf(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const std::uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    std::uint16_t half;
+    if (bits >= 0x47800000u) {
+        // Too large for half precision, infinity or NaN
+        half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    } else if (bits < 0x38800000u) {
+        // Subnormal or zero, let the float addition round the mantissa into place
+        const std::uint32_t magicBits = 126u << 23;
+        float magic, sum;
+        std::memcpy(&magic, &magicBits, sizeof(magic));
+        std::memcpy(&sum, &bits, sizeof(sum));
+        sum += magic;
+        std::uint32_t sumBits;
+        std::memcpy(&sumBits, &sum, sizeof(sumBits));
+        half = static_cast<std::uint16_t>(sumBits - magicBits);
+    } else {
+        const std::uint32_t odd = (bits >> 13) & 1u;
+        bits -= (127u - 15u) << 23;
+        bits += 0xfffu + odd;
+        half = static_cast<std::uint16_t>(bits >> 13);
+    }
+    return static_cast<std::uint16_t>(sign >> 16) | half;
+}
+
+bool isConversionTarget(NumericType type, size_t itemsize) {
+    return (type == NumericType::Float && (itemsize == 4 || itemsize == 2)) ||
+           (type == NumericType::UnsignedInteger && (itemsize == 1 || itemsize == 2));
+}
+
+void convertStrided(const void* src, const std::vector<std::ptrdiff_t>& srcStrides,
+                    NumericType srcType, size_t srcItemsize, void* dst, NumericType dstType,
+                    size_t dstItemsize, const std::vector<size_t>& shape, double scale,
+                    double offset, CopyVisitor* visitor) {
+    if (!isConversionTarget(dstType, dstItemsize))
+        throw Exception("Conversion target not supported", IvwContextCustom("convertStrided"));
+    if (scale == 0.0)
+        throw Exception("Conversion scale must not be zero", IvwContextCustom("convertStrided"));
+
+    const Rows rows(shape, srcStrides);
+    if (rows.count == 0)
+        return;
+    dispatchType(srcType, srcItemsize, Convert{static_cast<const char*>(src), rows,
+                                               static_cast<char*>(dst), dstType, dstItemsize,
+                                               scale, offset, visitor});
+}
+
+dvec2 getValueRange(const void* src, const std::vector<std::ptrdiff_t>& srcStrides,
+                    NumericType srcType, size_t srcItemsize, const std::vector<size_t>& shape) {
+    const Rows rows(shape, srcStrides);
+    if (rows.count == 0)
+        return dvec2(0.0);
+    return dispatchType(srcType, srcItemsize, ValueRange{static_cast<const char*>(src), rows});
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,88 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_CONVERT_H
+#define IVW_PYDATA_CONVERT_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <modules/pydata/util/stridedcopy.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Return the value of a half precision float given by its bits
+ */
+IVW_MODULE_PYDATA_API float halfToFloat(std::uint16_t half);
+
+/**
+ * Return the bits of the half precision float nearest to the value
+ */
+IVW_MODULE_PYDATA_API std::uint16_t floatToHalf(float value);
+
+/**
+ * Return true if data can be converted to the given type by convertStrided, i.e. to float32,
+ * float16, uint8 or uint16
+ */
+IVW_MODULE_PYDATA_API bool isConversionTarget(NumericType type, size_t itemsize);
+
+/**
+ * Convert an n-dimensional array of one type into a packed row-major array of another type in a
+ * single pass, stored = (value - offset) / scale. Integer targets are rounded to nearest and
+ * clamped to the range of the type. Strides are given in bytes and may be negative. The work is
+ * split over the Inviwo thread pool. An optional visitor sees every converted element once,
+ * while it is still in the cache.
+ */
+IVW_MODULE_PYDATA_API void convertStrided(const void* src,
+                                          const std::vector<std::ptrdiff_t>& srcStrides,
+                                          NumericType srcType, size_t srcItemsize, void* dst,
+                                          NumericType dstType, size_t dstItemsize,
+                                          const std::vector<size_t>& shape, double scale = 1.0,
+                                          double offset = 0.0, CopyVisitor* visitor = nullptr);
+
+/**
+ * Return the minimum and maximum value of an n-dimensional strided array, ignoring NaN. If there
+ * is no value other than NaN, the minimum is greater than the maximum.
+ */
+IVW_MODULE_PYDATA_API dvec2 getValueRange(const void* src,
+                                          const std::vector<std::ptrdiff_t>& srcStrides,
+                                          NumericType srcType, size_t srcItemsize,
+                                          const std::vector<size_t>& shape);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_CONVERT_H
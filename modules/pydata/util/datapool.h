@@ -0,0 +1,194 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_DATAPOOL_H
+#define IVW_PYDATA_DATAPOOL_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/memorybudget.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Drop a reference to data on the main thread. The data may have GL representations, which can
+ * only be destroyed there.
+ */
+template <typename T>
+void releaseOnMainThread(std::shared_ptr<T> data) {
+    if (!data || isMainThread())
+        return;
+    // Only the queued call holds the reference, so it cannot be dropped here if the main thread
+    // runs it before this returns
+    auto holder = std::make_shared<std::shared_ptr<T>>(std::move(data));
+    InviwoApplication::getPtr()->dispatchFront([holder]() { holder->reset(); });
+}
+
+/**
+ * \class DataPool
+ * \brief Pool of images or volumes for a source processor to fill and hand out
+ * Data that is no longer referenced outside the pool is reused, so streaming frames of the same
+ * size does not allocate once the pool is warm. The buffers are counted against the memory
+ * budget, which drops free data from the pool when it is exceeded. The pool is shared with the
+ * release functions of the budget, which may run after the processor is removed. All functions
+ * may be called from any thread.
+ */
+template <typename T>
+class DataPool : public std::enable_shared_from_this<DataPool<T>> {
+public:
+    /// Create the data around memory of the requested size, or return nullptr on failure
+    using Create = std::function<std::shared_ptr<T>(std::shared_ptr<MemoryAllocation> memory)>;
+
+    explicit DataPool(size_t size) : size_(size) {}
+
+    /**
+     * Set the number of data kept in the pool. Data beyond it is dropped from the pool, and
+     * freed once it is no longer used elsewhere.
+     */
+    void setSize(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        size_ = size;
+        while (data_.size() > size) {
+            releaseOnMainThread(std::move(data_.back()));
+            data_.pop_back();
+            memory_.pop_back();
+        }
+    }
+
+    /**
+     * Return free data for which matches returns true, or create new data from bytes of memory
+     * counted against the budget. New data takes the place of free data of another size, or is
+     * added if the pool is not full. Throws if the data cannot be created.
+     */
+    std::shared_ptr<T> get(size_t bytes, std::function<bool(const T&)> matches, Create create) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        auto it = std::find_if(data_.begin(), data_.end(), [&](const std::shared_ptr<T>& data) {
+            return isFree(data) && matches(*data);
+        });
+        if (it != data_.end()) {
+            IngestStats::getPtr().addReuse();
+            if (auto memory = memory_[it - data_.begin()].lock())
+                memory->touch();
+            return *it;
+        }
+
+        // The buffer is counted against the memory budget for as long as the data is alive
+        IngestStats::getPtr().addAllocation();
+        auto memory = MemoryBudget::getPtr().allocate(bytes);
+        auto data = create(memory);
+        if (!data)
+            throw Exception("Cannot allocate buffer of " + std::to_string(bytes) + " bytes",
+                            IvwContextCustom("DataPool"));
+        allocated_.erase(std::remove_if(allocated_.begin(), allocated_.end(),
+                                        [](const std::weak_ptr<T>& d) { return d.expired(); }),
+                         allocated_.end());
+        allocated_.push_back(data);
+
+        // The budget may drop the data from the pool while it is free
+        auto freeIt = std::find_if(data_.begin(), data_.end(), isFree);
+        if (freeIt != data_.end()) {
+            releaseOnMainThread(std::move(*freeIt));
+            *freeIt = data;
+            memory_[freeIt - data_.begin()] = memory;
+            memory->setRelease(evict(this->shared_from_this(), data.get()));
+        } else if (data_.size() < size_) {
+            data_.push_back(data);
+            memory_.push_back(memory);
+            memory->setRelease(evict(this->shared_from_this(), data.get()));
+        }
+
+        // Evicting takes the lock of the pool
+        lock.unlock();
+        MemoryBudget::getPtr().enforce();
+        return data;
+    }
+
+    /**
+     * Return true if the data was created by the pool, as opposed to e.g. borrowed data
+     */
+    bool isAllocated(const std::shared_ptr<T>& data) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::any_of(allocated_.begin(), allocated_.end(),
+                           [&](const std::weak_ptr<T>& d) { return d.lock() == data; });
+    }
+
+private:
+    // Only the pool holds a reference to free data. References to pooled data are only handed
+    // out by get, and the weak references in allocated_ are only locked by isAllocated, both
+    // under the lock. A count of 1 seen under the lock therefore cannot grow behind our back,
+    // while a higher count may only be stale on the safe side.
+    static bool isFree(const std::shared_ptr<T>& data) { return data.use_count() == 1; }
+
+    // Return the release function of data in the pool, which drops it if it is free
+    static std::function<bool()> evict(std::weak_ptr<DataPool> weakPool, const T* key) {
+        return [weakPool, key]() {
+            auto pool = weakPool.lock();
+            if (!pool)
+                return false;
+
+            std::lock_guard<std::mutex> lock(pool->mutex_);
+            auto& data = pool->data_;
+            auto it = std::find_if(data.begin(), data.end(),
+                                   [key](const std::shared_ptr<T>& d) { return d.get() == key; });
+            if (it == data.end() || !isFree(*it))
+                return false;
+
+            releaseOnMainThread(std::move(*it));
+            pool->memory_.erase(pool->memory_.begin() + (it - data.begin()));
+            data.erase(it);
+            return true;
+        };
+    }
+
+    mutable std::mutex mutex_;
+    size_t size_;
+    std::vector<std::shared_ptr<T>> data_;
+    std::vector<std::weak_ptr<MemoryEntry>> memory_;
+    // All data created, pooled or not, to tell it apart from data created elsewhere
+    std::vector<std::weak_ptr<T>> allocated_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_DATAPOOL_H
@@ -0,0 +1,220 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/downsample.h>
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Half precision float, stored as its bits and reduced in single precision
+struct Half {};
+
+// How elements of type T are stored and read as values
+template <typename T>
+struct Element {
+    using Stored = T;
+    using Value = T;
+    static Value load(Stored stored) { return stored; }
+    static Stored store(Value value) { return value; }
+};
+
+template <>
+struct Element<Half> {
+    using Stored = std::uint16_t;
+    using Value = float;
+    static Value load(Stored stored) { return halfToFloat(stored); }
+    static Stored store(Value value) { return floatToHalf(value); }
+};
+
+// Sums of up to 32-bit integers are kept in 64-bit integers, which cannot overflow for any
+// reasonable factor. 64-bit integers are summed in double precision.
+template <typename V>
+using ValueAccumulator = typename std::conditional<
+    std::is_floating_point<V>::value, V,
+    typename std::conditional<
+        (sizeof(V) > 4), double,
+        typename std::conditional<std::is_signed<V>::value, std::int64_t,
+                                  std::uint64_t>::type>::type>::type;
+
+template <typename T>
+using Accumulator = ValueAccumulator<typename Element<T>::Value>;
+
+template <typename A>
+A divide(A sum, size_t count, std::true_type) {
+    return sum / static_cast<A>(count);
+}
+
+// Rounds to nearest for integers
+template <typename A>
+A divide(A sum, size_t count, std::false_type) {
+    return static_cast<A>(std::floor(static_cast<double>(sum) / count + 0.5));
+}
+
+// Reduce the blocks of one destination row. The source rows of the block are visited one at a
+// time, so the innermost loop runs over consecutive memory.
+template <typename T, DownsampleMode Mode>
+void downsampleRow(const typename Element<T>::Stored* src, const size3_t& dimensions,
+                   typename Element<T>::Stored* dst, size_t dstWidth, size_t components,
+                   size_t factor, size_t y, size_t z, std::vector<Accumulator<T>>& acc) {
+    using E = Element<T>;
+    using V = typename E::Value;
+    using A = Accumulator<T>;
+    const size_t width = dimensions.x;
+    const size_t y1 = std::min((y + 1) * factor, dimensions.y);
+    const size_t z1 = std::min((z + 1) * factor, dimensions.z);
+
+    const A initial = Mode == DownsampleMode::Box ? A(0) : std::numeric_limits<V>::lowest();
+    std::fill(acc.begin(), acc.end(), initial);
+
+    for (size_t sz = z * factor; sz < z1; ++sz) {
+        for (size_t sy = y * factor; sy < y1; ++sy) {
+            const auto row = src + (sz * dimensions.y + sy) * width * components;
+            for (size_t x = 0; x < dstWidth; ++x) {
+                const size_t x0 = x * factor * components;
+                const size_t x1 = std::min((x + 1) * factor, width) * components;
+                A* voxel = &acc[x * components];
+                for (size_t i = x0; i < x1; i += components) {
+                    for (size_t c = 0; c < components; ++c) {
+                        const auto value = static_cast<A>(E::load(row[i + c]));
+                        if (Mode == DownsampleMode::Box)
+                            voxel[c] += value;
+                        else
+                            voxel[c] = std::max(voxel[c], value);
+                    }
+                }
+            }
+        }
+    }
+
+    const size_t blockRows = (y1 - y * factor) * (z1 - z * factor);
+    for (size_t x = 0; x < dstWidth; ++x) {
+        const size_t count = (std::min((x + 1) * factor, width) - x * factor) * blockRows;
+        for (size_t c = 0; c < components; ++c) {
+            A value = acc[x * components + c];
+            if (Mode == DownsampleMode::Box)
+                value = divide(value, count, std::is_floating_point<V>());
+            dst[x * components + c] = E::store(static_cast<V>(value));
+        }
+    }
+}
+
+struct DownsampleJob {
+    const void* src;
+    size3_t dimensions;
+    void* dst;
+    size_t components;
+    size_t factor;
+    DownsampleMode mode;
+};
+
+template <typename T, DownsampleMode Mode>
+void downsampleT(const DownsampleJob& job) {
+    const auto dstDimensions = getDownsampledDimensions(job.dimensions, job.factor);
+    const size_t rows = dstDimensions.y * dstDimensions.z;
+    const size_t rowSize = dstDimensions.x * job.components;
+
+    // Each parallel job handles a run of rows, enough to amortize the scheduling
+    const size_t rowsPerJob = std::max<size_t>(1, rows / (8 * getConcurrency()));
+    const size_t jobs = (rows + rowsPerJob - 1) / rowsPerJob;
+    parallelFor(jobs, [&](size_t index) {
+        std::vector<Accumulator<T>> acc(rowSize);
+        const size_t end = std::min(rows, (index + 1) * rowsPerJob);
+        for (size_t row = index * rowsPerJob; row < end; ++row) {
+            using S = typename Element<T>::Stored;
+            downsampleRow<T, Mode>(static_cast<const S*>(job.src), job.dimensions,
+                                   static_cast<S*>(job.dst) + row * rowSize, dstDimensions.x,
+                                   job.components, job.factor, row % dstDimensions.y,
+                                   row / dstDimensions.y, acc);
+        }
+    });
+}
+
+template <typename T>
+void downsampleT(const DownsampleJob& job) {
+    if (job.mode == DownsampleMode::Box)
+        downsampleT<T, DownsampleMode::Box>(job);
+    else
+        downsampleT<T, DownsampleMode::Max>(job);
+}
+
+} // namespace
+
+size3_t getDownsampledDimensions(const size3_t& dimensions, size_t factor) {
+    return size3_t((dimensions.x + factor - 1) / factor, (dimensions.y + factor - 1) / factor,
+                   (dimensions.z + factor - 1) / factor);
+}
+
+void downsample(const void* src, const size3_t& dimensions, void* dst,
+                const DataFormatBase* format, size_t factor, DownsampleMode mode) {
+    if (factor == 0)
+        throw Exception("Downsampling factor must be positive", IvwContextCustom("downsample"));
+
+    const size_t components = format->getComponents();
+    const size_t bytes = format->getSize() / components;
+    const DownsampleJob job{src, dimensions, dst, components, factor, mode};
+    switch (format->getNumericType()) {
+        case NumericType::Float:
+            if (bytes == 2) return downsampleT<Half>(job);
+            if (bytes == 4) return downsampleT<float>(job);
+            if (bytes == 8) return downsampleT<double>(job);
+            break;
+        case NumericType::SignedInteger:
+            if (bytes == 1) return downsampleT<std::int8_t>(job);
+            if (bytes == 2) return downsampleT<std::int16_t>(job);
+            if (bytes == 4) return downsampleT<std::int32_t>(job);
+            if (bytes == 8) return downsampleT<std::int64_t>(job);
+            break;
+        case NumericType::UnsignedInteger:
+            if (bytes == 1) return downsampleT<std::uint8_t>(job);
+            if (bytes == 2) return downsampleT<std::uint16_t>(job);
+            if (bytes == 4) return downsampleT<std::uint32_t>(job);
+            if (bytes == 8) return downsampleT<std::uint64_t>(job);
+            break;
+        default:
+            break;
+    }
+    throw Exception("Downsampling not supported for " + std::string(format->getString()),
+                    IvwContextCustom("downsample"));
+}
+
+} // namespace
+
+} // namespace
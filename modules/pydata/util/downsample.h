@@ -0,0 +1,67 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_DOWNSAMPLE_H
+#define IVW_PYDATA_DOWNSAMPLE_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+namespace inviwo {
+
+class DataFormatBase;
+
+namespace pydata {
+
+enum class DownsampleMode {
+    Box,  ///< Mean of each block, per component
+    Max   ///< Maximum of each block, per component
+};
+
+/**
+ * Return the dimensions of data downsampled by factor, rounded up so that every source voxel
+ * belongs to a block
+ */
+IVW_MODULE_PYDATA_API size3_t getDownsampledDimensions(const size3_t& dimensions, size_t factor);
+
+/**
+ * Reduce each block of factor^3 voxels of the packed source data to one voxel of the packed
+ * destination data, which has the dimensions given by getDownsampledDimensions. Blocks at the
+ * upper borders are clamped to the data. Images are downsampled by passing a depth of 1.
+ * Runs in parallel over the destination slices and rows.
+ */
+IVW_MODULE_PYDATA_API void downsample(const void* src, const size3_t& dimensions, void* dst,
+                                      const DataFormatBase* format, size_t factor,
+                                      DownsampleMode mode);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_DOWNSAMPLE_H
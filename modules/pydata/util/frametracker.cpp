@@ -0,0 +1,94 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/frametracker.h>
+
+namespace inviwo {
+
+namespace pydata {
+
+FrameTracker::FrameTracker() : submitted_(0), handedOver_(0), consumed_(0), closed_(false) {}
+
+size_t FrameTracker::submit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return ++submitted_;
+}
+
+bool FrameTracker::handOver(size_t frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (frame <= handedOver_)
+        return false;
+    handedOver_ = frame;
+    return true;
+}
+
+void FrameTracker::consume() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (consumed_ == handedOver_)
+            return;
+        consumed_ = handedOver_;
+    }
+    consumedCondition_.notify_all();
+}
+
+void FrameTracker::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+    consumedCondition_.notify_all();
+}
+
+bool FrameTracker::waitConsumed(size_t frame, std::chrono::duration<double> timeout) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (frame == 0)
+        frame = submitted_;
+
+    auto done = [this, frame]() { return closed_ || consumed_ >= frame; };
+    if (timeout.count() < 0.0)
+        consumedCondition_.wait(lock, done);
+    else
+        consumedCondition_.wait_for(lock, timeout, done);
+    return consumed_ >= frame;
+}
+
+size_t FrameTracker::getSubmitted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return submitted_;
+}
+
+size_t FrameTracker::getConsumed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return consumed_;
+}
+
+} // namespace
+
+} // namespace
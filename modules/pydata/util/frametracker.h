@@ -0,0 +1,99 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_FRAMETRACKER_H
+#define IVW_PYDATA_FRAMETRACKER_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * \class FrameTracker
+ * \brief Counts the frames set on a source processor and the frames the network has consumed
+ * Frames are numbered from 1 in the order they are submitted. A frame is consumed once it, or a
+ * newer frame that replaced it, has been handed over and the processor has been processed.
+ * Producers wait on the tracker to pace themselves to the network.
+ */
+class IVW_MODULE_PYDATA_API FrameTracker {
+public:
+    FrameTracker();
+
+    /**
+     * Return the number of a new frame. May be called from any thread.
+     */
+    size_t submit();
+
+    /**
+     * The frame is about to be set on the outport, called on the main thread. Frames from
+     * different threads may arrive out of order. Returns false if a newer frame has already been
+     * handed over, in which case the frame must be dropped instead of replacing the newer one.
+     */
+    bool handOver(size_t frame);
+
+    /**
+     * The processor has been processed, which consumes the frame last handed over
+     */
+    void consume();
+
+    /**
+     * Wake up all waiting threads, nothing is consumed after this
+     */
+    void close();
+
+    /**
+     * Wait until the frame, or the latest frame submitted if 0, has been consumed. A negative
+     * timeout waits forever. Returns false on timeout or if the tracker was closed.
+     */
+    bool waitConsumed(size_t frame, std::chrono::duration<double> timeout);
+
+    size_t getSubmitted() const;
+    size_t getConsumed() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable consumedCondition_;
+    size_t submitted_;
+    size_t handedOver_;
+    size_t consumed_;
+    bool closed_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_FRAMETRACKER_H
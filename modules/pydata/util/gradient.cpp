@@ -0,0 +1,197 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/gradient.h>
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Half precision float, stored as its bits and differenced in single precision
+struct Half {};
+
+// How elements of type T are stored and read as single precision values
+template <typename T>
+struct Element {
+    using Stored = T;
+    static float load(Stored stored) { return static_cast<float>(stored); }
+};
+
+template <>
+struct Element<Half> {
+    using Stored = std::uint16_t;
+    static float load(Stored stored) { return halfToFloat(stored); }
+};
+
+struct GradientJob {
+    const void* src;
+    size3_t dimensions;
+    vec3 invSpacing;  // Value scale over the voxel spacing
+    vec3* gradient;
+    float* magnitude;
+};
+
+// Neighbours of a row along one axis, the difference is one-sided at the borders and zero if
+// the axis has a single voxel
+struct Stencil {
+    size_t lower;
+    size_t upper;
+    float scale;
+};
+
+Stencil getStencil(size_t i, size_t size, float invSpacing) {
+    const size_t lower = i > 0 ? i - 1 : i;
+    const size_t upper = i + 1 < size ? i + 1 : i;
+    const float scale = upper > lower ? invSpacing / static_cast<float>(upper - lower) : 0.0f;
+    return Stencil{lower, upper, scale};
+}
+
+// Compute the gradients of one row and return their largest magnitude. The neighbours along y
+// and z are whole rows, so every loop runs over consecutive memory and the interior of the row
+// is free of branches, which lets the compiler vectorize it.
+template <typename T>
+float gradientRow(const GradientJob& job, size_t y, size_t z, std::vector<float>& scratch) {
+    const size_t width = job.dimensions.x;
+    const size_t height = job.dimensions.y;
+    using S = typename Element<T>::Stored;
+    const auto load = &Element<T>::load;
+    const S* src = static_cast<const S*>(job.src);
+    const auto sy = getStencil(y, height, job.invSpacing.y);
+    const auto sz = getStencil(z, job.dimensions.z, job.invSpacing.z);
+    const S* row = src + (z * height + y) * width;
+    const S* y0 = src + (z * height + sy.lower) * width;
+    const S* y1 = src + (z * height + sy.upper) * width;
+    const S* z0 = src + (sz.lower * height + y) * width;
+    const S* z1 = src + (sz.upper * height + y) * width;
+
+    // Components of the row, kept apart so the loops below work on plain arrays
+    float* gx = scratch.data();
+    float* gy = gx + width;
+    float* gz = gy + width;
+    float* length = gz + width;
+
+    const float sx = 0.5f * job.invSpacing.x;
+    for (size_t x = 1; x + 1 < width; ++x)
+        gx[x] = sx * (load(row[x + 1]) - load(row[x - 1]));
+    if (width > 1) {
+        gx[0] = job.invSpacing.x * (load(row[1]) - load(row[0]));
+        gx[width - 1] = job.invSpacing.x * (load(row[width - 1]) - load(row[width - 2]));
+    } else {
+        gx[0] = 0.0f;
+    }
+    for (size_t x = 0; x < width; ++x) {
+        gy[x] = sy.scale * (load(y1[x]) - load(y0[x]));
+        gz[x] = sz.scale * (load(z1[x]) - load(z0[x]));
+        length[x] = std::sqrt(gx[x] * gx[x] + gy[x] * gy[x] + gz[x] * gz[x]);
+    }
+
+    const size_t offset = (z * height + y) * width;
+    if (job.gradient) {
+        vec3* gradient = job.gradient + offset;
+        for (size_t x = 0; x < width; ++x) gradient[x] = vec3(gx[x], gy[x], gz[x]);
+    }
+    if (job.magnitude)
+        std::copy(length, length + width, job.magnitude + offset);
+    return width > 0 ? *std::max_element(length, length + width) : 0.0f;
+}
+
+template <typename T>
+float computeGradientT(const GradientJob& job) {
+    const size_t rows = job.dimensions.y * job.dimensions.z;
+
+    // Each parallel job handles a run of rows, enough to amortize the scheduling
+    const size_t rowsPerJob = std::max<size_t>(1, rows / (8 * getConcurrency()));
+    const size_t jobs = (rows + rowsPerJob - 1) / rowsPerJob;
+    std::vector<float> maxima(jobs, 0.0f);
+    parallelFor(jobs, [&](size_t index) {
+        std::vector<float> scratch(4 * job.dimensions.x);
+        const size_t end = std::min(rows, (index + 1) * rowsPerJob);
+        for (size_t row = index * rowsPerJob; row < end; ++row) {
+            const float rowMax =
+                gradientRow<T>(job, row % job.dimensions.y, row / job.dimensions.y, scratch);
+            maxima[index] = std::max(maxima[index], rowMax);
+        }
+    });
+    return maxima.empty() ? 0.0f : *std::max_element(maxima.begin(), maxima.end());
+}
+
+} // namespace
+
+bool isGradientSupported(const DataFormatBase* format) {
+    return format->getComponents() == 1;
+}
+
+float computeGradient(const void* src, const size3_t& dimensions, const DataFormatBase* format,
+                      const vec3& spacing, vec3* gradient, float* magnitude, float scale) {
+    if (format->getComponents() != 1) {
+        throw Exception("Gradients are only supported for single channel data",
+                        IvwContextCustom("computeGradient"));
+    }
+    if (spacing.x <= 0.0f || spacing.y <= 0.0f || spacing.z <= 0.0f)
+        throw Exception("Voxel spacing must be positive", IvwContextCustom("computeGradient"));
+
+    const GradientJob job{src, dimensions, vec3(scale) / spacing, gradient, magnitude};
+    const size_t bytes = format->getSize();
+    switch (format->getNumericType()) {
+        case NumericType::Float:
+            if (bytes == 2) return computeGradientT<Half>(job);
+            if (bytes == 4) return computeGradientT<float>(job);
+            if (bytes == 8) return computeGradientT<double>(job);
+            break;
+        case NumericType::SignedInteger:
+            if (bytes == 1) return computeGradientT<std::int8_t>(job);
+            if (bytes == 2) return computeGradientT<std::int16_t>(job);
+            if (bytes == 4) return computeGradientT<std::int32_t>(job);
+            if (bytes == 8) return computeGradientT<std::int64_t>(job);
+            break;
+        case NumericType::UnsignedInteger:
+            if (bytes == 1) return computeGradientT<std::uint8_t>(job);
+            if (bytes == 2) return computeGradientT<std::uint16_t>(job);
+            if (bytes == 4) return computeGradientT<std::uint32_t>(job);
+            if (bytes == 8) return computeGradientT<std::uint64_t>(job);
+            break;
+        default:
+            break;
+    }
+    throw Exception("Gradients not supported for " + std::string(format->getString()),
+                    IvwContextCustom("computeGradient"));
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,65 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_GRADIENT_H
+#define IVW_PYDATA_GRADIENT_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+namespace inviwo {
+
+class DataFormatBase;
+
+namespace pydata {
+
+/**
+ * Return true if computeGradient supports the format, i.e. single channel data of any type.
+ * Half precision floats are read in single precision.
+ */
+IVW_MODULE_PYDATA_API bool isGradientSupported(const DataFormatBase* format);
+
+/**
+ * Compute the gradient of packed single channel data by central differences, which are one-sided
+ * at the borders. Spacing is the distance between neighbouring voxels along each axis, and the
+ * gradient is taken of the values scale * data, e.g. the slope of the data mapping of quantized
+ * data. Either output may be nullptr, the gradients are written as vectors and/or as their
+ * magnitudes, one per voxel. Runs in parallel over the rows. Returns the largest gradient
+ * magnitude.
+ */
+IVW_MODULE_PYDATA_API float computeGradient(const void* src, const size3_t& dimensions,
+                                            const DataFormatBase* format, const vec3& spacing,
+                                            vec3* gradient, float* magnitude,
+                                            float scale = 1.0f);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_GRADIENT_H
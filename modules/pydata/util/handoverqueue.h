@@ -0,0 +1,126 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_HANDOVERQUEUE_H
+#define IVW_PYDATA_HANDOVERQUEUE_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * \class HandoverQueue
+ * \brief Passes frames set on a source processor from any thread to the main thread
+ * Frames pushed on the main thread are handed over right away. Frames from other threads are
+ * queued, and dropped if the queue has been destroyed along with its processor in the meantime.
+ * When coalescing, only the latest frame waits for the main thread and a newer one takes the
+ * place of the one already queued, which is counted as dropped.
+ */
+template <typename T>
+class HandoverQueue {
+public:
+    /// Hand the data over, called on the main thread
+    using HandOver = std::function<void(T data, size_t frame)>;
+
+    explicit HandoverQueue(HandOver handOver)
+        : handOver_(std::move(handOver))
+        , coalescing_(false)
+        , pendingFrame_(0)
+        , alive_(std::make_shared<bool>(true)) {}
+    HandoverQueue(const HandoverQueue&) = delete;
+    HandoverQueue& operator=(const HandoverQueue&) = delete;
+
+    void setCoalescing(bool coalescing) { coalescing_ = coalescing; }
+
+    void push(T data, size_t frame) {
+        if (isMainThread()) {
+            handOver_(std::move(data), frame);
+            return;
+        }
+
+        std::weak_ptr<bool> alive = alive_;
+        if (!coalescing_) {
+            InviwoApplication::getPtr()->dispatchFront([this, alive, data, frame]() {
+                if (alive.lock()) handOver_(data, frame);
+            });
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            const bool queued = pendingFrame_ != 0;
+            if (queued) IngestStats::getPtr().addDropped();
+            // Frames from different threads may arrive out of order, an older one is dropped
+            if (frame > pendingFrame_) {
+                pending_ = std::move(data);
+                pendingFrame_ = frame;
+            }
+            if (queued) return;
+        }
+        InviwoApplication::getPtr()->dispatchFront([this, alive]() {
+            if (!alive.lock()) return;
+            std::unique_lock<std::mutex> lock(mutex_);
+            auto pending = std::move(pending_);
+            pending_ = T();
+            const auto pendingFrame = pendingFrame_;
+            pendingFrame_ = 0;
+            lock.unlock();
+            handOver_(std::move(pending), pendingFrame);
+        });
+    }
+
+private:
+    HandOver handOver_;
+    std::atomic<bool> coalescing_;
+
+    // Latest frame waiting for the main thread when coalescing, frame 0 if there is none
+    std::mutex mutex_;
+    T pending_;
+    size_t pendingFrame_;
+
+    // Queued calls are dropped once the queue is destroyed, which happens on the main thread
+    std::shared_ptr<bool> alive_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_HANDOVERQUEUE_H
@@ -0,0 +1,788 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/ingest.h>
+#include <modules/pydata/datastructures/layerrambuffer.h>
+#include <modules/pydata/datastructures/volumerambuffer.h>
+#include <modules/pydata/processors/imagesourcebuffer.h>
+#include <modules/pydata/processors/meshsourcebuffer.h>
+#include <modules/pydata/processors/volumesequencesourcebuffer.h>
+#include <modules/pydata/processors/volumesourcebuffer.h>
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/ingeststats.h>
+#include <modules/pydata/util/memorybudget.h>
+#include <modules/pydata/util/memorymappedfile.h>
+#include <modules/pydata/util/processorhandle.h>
+#include <modules/pydata/util/stridedcopy.h>
+#include <inviwo/core/datastructures/buffer/buffer.h>
+#include <inviwo/core/datastructures/buffer/bufferramprecision.h>
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Return the data format of a buffer with the given number of components
+const DataFormatBase* getDataFormat(const BufferView& buffer, size_t components) {
+    if (components > 4)
+        throw std::runtime_error("Too many components (expected maximum 4)");
+    auto dataFormat = DataFormatBase::get(buffer.type, components, buffer.itemsize * 8);
+    if (!dataFormat)
+        throw std::runtime_error("Data format not supported");
+    return dataFormat;
+}
+
+// Return a new buffer of the given format and number of elements
+std::shared_ptr<BufferBase> createBuffer(const DataFormatBase* format, size_t size) {
+    switch (format->getId()) {
+#define DataFormatIdMacro(i)                                                             \
+    case DataFormatId::i:                                                                \
+        return std::make_shared<Buffer<Data##i::type>>(                                  \
+            std::make_shared<BufferRAMPrecision<Data##i::type>>(size));
+#include <inviwo/core/util/formatsdefinefunc.h>
+        default:
+            return nullptr;
+    }
+}
+
+// Check that the buffer fits into a sub-box of volume data of the given dimensions and format.
+// The offset is given in the index order of the buffer.
+void validateRegion(const BufferView& buffer, const std::vector<size_t>& offset,
+                    const size3_t& dimensions, const DataFormatBase* format) {
+    if (buffer.shape.size() < 3 || buffer.shape.size() > 4)
+        throw std::runtime_error("Incompatible buffer dimensions (expected 3 or 4)");
+    if (offset.size() != 3)
+        throw std::runtime_error("Incompatible offset (expected 3 values)");
+
+    size_t components = buffer.shape.size() == 3 ? 1 : buffer.shape[3];
+    if (getDataFormat(buffer, components) != format)
+        throw std::runtime_error("Data format does not match the volume");
+
+    // The shape of the whole volume in buffer index order, see prepareVolume
+    std::vector<size_t> shape{dimensions.y, dimensions.x, dimensions.z};
+    for (size_t i = 0; i < 3; ++i) {
+        if (offset[i] + buffer.shape[i] > shape[i])
+            throw std::runtime_error("Region is outside the volume");
+    }
+}
+
+// Copy the buffer into a sub-box of volume data with the given dimensions and format, at the
+// offset given in buffer index order
+void copyToRegion(const BufferView& buffer, const std::vector<size_t>& offset, void* data,
+                  const size3_t& dimensions, const DataFormatBase* format) {
+    validateRegion(buffer, offset, dimensions, format);
+
+    // The shape of the whole volume in buffer index order, see prepareVolume
+    std::vector<size_t> shape{dimensions.y, dimensions.x, dimensions.z};
+    if (buffer.shape.size() == 4)
+        shape.push_back(buffer.shape[3]);
+
+    // Copy into the sub-box using the strides of the whole volume
+    PhaseTimer copyTimer(IngestPhase::Copy);
+    IngestStats::getPtr().addBytesCopied(buffer.itemsize * buffer.getSize());
+    auto strides = getPackedStrides(shape, buffer.itemsize);
+    auto regionData = static_cast<char*>(data);
+    for (size_t i = 0; i < 3; ++i)
+        regionData += offset[i] * strides[i];
+    copyStrided(buffer.data, buffer.strides, regionData, strides, buffer.shape, buffer.itemsize);
+}
+
+// A processor given directly, used as is
+template <typename T>
+struct DirectAccess {
+    T* processor;
+
+    template <typename F>
+    auto with(F f) const -> decltype(f(processor)) {
+        return f(processor);
+    }
+};
+
+// The processor of a handle, looked up for each use and only kept from being removed while it
+// is used, so it is not locked while data is copied. Throws if it has been removed.
+template <typename T>
+struct HandleAccess {
+    ProcessorHandle<T>& handle;
+
+    template <typename F>
+    auto with(F f) const -> decltype(f(static_cast<T*>(nullptr))) {
+        typename ProcessorHandle<T>::Lock lock;
+        PhaseTimer lookupTimer(IngestPhase::Lookup);
+        T* processor = handle.get(lock);
+        lookupTimer.stop();
+        return f(processor);
+    }
+};
+
+template <typename Access>
+std::shared_ptr<Image> prepareImageT(const Access& imageSource, const BufferView& buffer,
+                                     const IngestOptions& options) {
+    IngestStats::getPtr().addImage();
+    PhaseTimer validateTimer(IngestPhase::Validate);
+
+    // Determine the number of components
+    if (buffer.shape.size() < 2 || buffer.shape.size() > 3)
+        throw std::runtime_error("Incompatible buffer dimensions (expected 2 or 3)");
+    size_t components = buffer.shape.size() == 2 ? 1 : buffer.shape[2];
+    auto dataFormat = getDataFormat(buffer, components);
+    validateTimer.stop();
+
+    // Create the layer RAM representation
+    // Note that the buffer shape is described in matrix notation (rows,columns)
+    // but the layer uses an image notation (width,height) where width = columns and height = rows
+    // The OpenGL coordinate frame (origin in the lower left corner) furthermore renders the
+    // array up-side down, which I'm not yet sure how to handle in a stringent manner
+    auto dimensions = size2_t(buffer.shape[1], buffer.shape[0]);
+
+    // Borrow the buffer memory if asked to, the owner is kept alive by the representation.
+    // Only writable buffers are borrowed, so the editable representation may write to it.
+    if (!options.copy && buffer.isBorrowable()) {
+        IngestStats::getPtr().addBorrow();
+        auto layerRAM = createLayerRAMBuffer(dimensions, LayerType::Color, dataFormat,
+                                             const_cast<void*>(buffer.data), buffer.owner);
+        if (!layerRAM)
+            throw std::runtime_error("Cannot wrap layer buffer");
+        return std::make_shared<Image>(std::make_shared<Layer>(layerRAM));
+    }
+
+    // Reuse an image from the pool of the processor if one is free
+    PhaseTimer allocateTimer(IngestPhase::Allocate);
+    auto image = imageSource.with([&](ImageSourceBuffer* source) {
+        return source->getPooledImage(dimensions, dataFormat);
+    });
+    auto layerRAM = image->getColorLayer()->getEditableRepresentation<LayerRAM>();
+    allocateTimer.stop();
+
+    // Repack the buffer into row-major order, whatever its strides
+    PhaseTimer copyTimer(IngestPhase::Copy);
+    IngestStats::getPtr().addBytesCopied(buffer.itemsize * buffer.getSize());
+    copyStrided(buffer.data, buffer.strides, layerRAM->getData(),
+                getPackedStrides(buffer.shape, buffer.itemsize), buffer.shape, buffer.itemsize);
+    return image;
+}
+
+template <typename Access>
+std::shared_ptr<Volume> prepareVolumeT(const Access& volumeSource, const BufferView& buffer,
+                                       const IngestOptions& options,
+                                       std::shared_ptr<const ValueStats>& stats) {
+    IngestStats::getPtr().addVolume();
+    PhaseTimer validateTimer(IngestPhase::Validate);
+
+    // Determine the number of components
+    if (buffer.shape.size() < 3 || buffer.shape.size() > 4)
+        throw std::runtime_error("Incompatible buffer dimensions (expected 3 or 4)");
+    size_t components = buffer.shape.size() == 3 ? 1 : buffer.shape[3];
+    auto dataFormat = getDataFormat(buffer, components);
+
+    // The format of the volume differs from the buffer if it is converted
+    const bool convert = options.targetType != NumericType::NotSpecialized;
+    const bool quantize = convert && options.targetType != NumericType::Float;
+    if (!convert && !options.autoScale)
+        throw std::runtime_error("A scale and offset are only applied when converting to a dtype");
+    if (convert) {
+        if (!isConversionTarget(options.targetType, options.targetItemsize))
+            throw std::runtime_error(
+                "Conversion only supported to float32, float16, uint8 and uint16");
+        dataFormat =
+            DataFormatBase::get(options.targetType, components, options.targetItemsize * 8);
+        if (!dataFormat)
+            throw std::runtime_error("Data format not supported");
+    }
+    const double maxStored = options.targetItemsize == 1 ? 255.0 : 65535.0;
+
+    // Created before anything is allocated, so that unsupported formats fail here
+    std::unique_ptr<ValueStatsVisitor> statsVisitor;
+    if (options.valueRange || options.bins > 0)
+        statsVisitor = ValueStatsVisitor::create(dataFormat, options.bins);
+    validateTimer.stop();
+
+    // Create the volume RAM representation
+    // Note that the buffer shape is described in matrix notation (rows,columns,slices)
+    // but the volume uses an image notation (width,height,slices) where width = columns and height = rows
+    // The OpenGL coordinate frame (origin in the lower left corner) furthermore renders the
+    // array up-side down, which I'm not yet sure how to handle in a stringent manner
+    auto dimensions = size3_t(buffer.shape[1], buffer.shape[0], buffer.shape[2]);
+    const size_t itemsize = convert ? options.targetItemsize : buffer.itemsize;
+    const size_t bytes = itemsize * buffer.getSize();
+
+    // Borrow the buffer memory if asked to, the owner is kept alive by the representation.
+    // Only writable buffers are borrowed, so the editable representation may write to it.
+    std::shared_ptr<Volume> volume;
+    const void* volumeData;
+    double scale = 1.0, offset = 0.0;
+    if (!convert && !options.copy && buffer.isBorrowable()) {
+        IngestStats::getPtr().addBorrow();
+        auto volumeRAM = createVolumeRAMBuffer(dimensions, dataFormat,
+                                               const_cast<void*>(buffer.data), buffer.owner);
+        if (!volumeRAM)
+            throw std::runtime_error("Cannot wrap volume buffer");
+        volume = std::make_shared<Volume>(volumeRAM);
+        volumeData = buffer.data;
+        if (statsVisitor)
+            statsVisitor->scan(volumeData, bytes);
+    } else {
+        // Reuse a volume from the pool of the processor if one is free
+        PhaseTimer allocateTimer(IngestPhase::Allocate);
+        volume = volumeSource.with([&](VolumeSourceBuffer* source) {
+            return source->getPooledVolume(dimensions, dataFormat);
+        });
+        auto volumeRAM = volume->getEditableRepresentation<VolumeRAM>();
+        volumeData = volumeRAM->getData();
+        allocateTimer.stop();
+
+        PhaseTimer copyTimer(IngestPhase::Copy);
+        IngestStats::getPtr().addBytesCopied(buffer.itemsize * buffer.getSize());
+        if (convert) {
+            // A given scale and offset apply to any target. Otherwise the quantization is fitted
+            // to the values of the buffer, which takes a pass of its own, and float targets keep
+            // the values. Without any values other than NaN there is nothing to fit.
+            if (!options.autoScale) {
+                scale = options.scale;
+                offset = options.offset;
+            } else if (quantize) {
+                auto range = getValueRange(buffer.data, buffer.strides, buffer.type,
+                                           buffer.itemsize, buffer.shape);
+                if (range.x <= range.y) {
+                    offset = range.x;
+                    scale = range.y > range.x ? (range.y - range.x) / maxStored : 1.0;
+                }
+            }
+
+            // Convert and repack the buffer, whatever its strides, and gather the statistics of
+            // each part while it is still in the cache
+            convertStrided(buffer.data, buffer.strides, buffer.type, buffer.itemsize,
+                           volumeRAM->getData(), options.targetType, options.targetItemsize,
+                           buffer.shape, scale, offset, statsVisitor.get());
+        } else {
+            // Repack the buffer into row-major order, whatever its strides, and gather the
+            // statistics of each part while it is still in the cache
+            copyStrided(buffer.data, buffer.strides, volumeRAM->getData(),
+                        getPackedStrides(buffer.shape, buffer.itemsize), buffer.shape,
+                        buffer.itemsize, statsVisitor.get());
+        }
+    }
+
+    stats = nullptr;
+    if (statsVisitor) {
+        auto valueStats = std::make_shared<ValueStats>(statsVisitor->finish(volumeData, bytes));
+        volume->dataMap_.dataRange = valueStats->range;
+        volume->dataMap_.valueRange = valueStats->range;
+
+        // Report quantized statistics as values
+        valueStats->range = valueStats->range * scale + offset;
+        valueStats->histogramRange = valueStats->histogramRange * scale + offset;
+        stats = valueStats;
+    }
+
+    // Stored values map linearly to the values they were converted from
+    if (convert) {
+        if (quantize && !statsVisitor)
+            volume->dataMap_.dataRange = dvec2(0.0, maxStored);
+        volume->dataMap_.valueRange = volume->dataMap_.dataRange * scale + offset;
+    }
+
+    return volume;
+}
+
+template <typename Access>
+void setImageT(const Access& imageSource, const BufferView& buffer,
+               const IngestOptions& options) {
+    auto image = prepareImageT(imageSource, buffer, options);
+    imageSource.with([&](ImageSourceBuffer* source) { source->setData(image); });
+}
+
+template <typename Access>
+void setVolumeT(const Access& volumeSource, const BufferView& buffer,
+                const IngestOptions& options) {
+    std::shared_ptr<const ValueStats> stats;
+    auto volume = prepareVolumeT(volumeSource, buffer, options, stats);
+    volumeSource.with([&](VolumeSourceBuffer* source) { source->setData(volume, stats); });
+}
+
+// Describe shape.size() dimensional raw data mapped from a file, the view owns the mapping
+std::shared_ptr<MemoryMappedFile> mapBuffer(const std::string& path, NumericType type,
+                                            size_t itemsize, const std::vector<size_t>& shape,
+                                            size_t offset, BufferView& buffer) {
+    if (itemsize == 0 || offset % itemsize != 0)
+        throw std::runtime_error("Offset must be a multiple of the item size");
+
+    buffer.type = type;
+    buffer.itemsize = itemsize;
+    buffer.shape = shape;
+    buffer.strides = getPackedStrides(shape, itemsize);
+    auto file = std::make_shared<MemoryMappedFile>(path, offset, itemsize * buffer.getSize());
+    buffer.data = file->getData();
+    buffer.owner = file;
+    // Mappings are copy-on-write, writes never reach the file
+    buffer.writable = true;
+    return file;
+}
+
+template <typename Access>
+void mapVolumeT(const Access& volumeSource, const std::string& path, NumericType type,
+                size_t itemsize, const std::vector<size_t>& shape, size_t offset, bool prefetch,
+                const IngestOptions& options) {
+    // The mapping is owned by the volume representation and unmapped along with it
+    BufferView buffer;
+    auto file = mapBuffer(path, type, itemsize, shape, offset, buffer);
+    if (prefetch)
+        file->prefetch(0, file->getSize());
+    else if (options.valueRange || options.bins > 0)
+        file->adviseSequential();
+
+    IngestOptions borrow(options);
+    borrow.copy = false;
+    setVolumeT(volumeSource, buffer, borrow);
+}
+
+template <typename Access>
+void setVolumeSequenceT(const Access& sequenceSource, const std::vector<BufferView>& buffers,
+                        const IngestOptions& options) {
+    PhaseTimer validateTimer(IngestPhase::Validate);
+    if (buffers.empty())
+        throw std::runtime_error("No volumes in the sequence");
+
+    // A single buffer holds all steps along its first axis, a list holds one step per buffer
+    const auto& first = buffers.front();
+    size_t steps;
+    std::vector<size_t> shape;
+    if (buffers.size() == 1) {
+        if (first.shape.size() < 4 || first.shape.size() > 5)
+            throw std::runtime_error("Incompatible buffer dimensions (expected 4 or 5)");
+        steps = first.shape[0];
+        shape.assign(first.shape.begin() + 1, first.shape.end());
+    } else {
+        if (first.shape.size() < 3 || first.shape.size() > 4)
+            throw std::runtime_error("Incompatible buffer dimensions (expected 3 or 4)");
+        for (const auto& buffer : buffers) {
+            if (buffer.shape != first.shape || buffer.type != first.type ||
+                buffer.itemsize != first.itemsize)
+                throw std::runtime_error("Volumes of a sequence must have the same shape and type");
+        }
+        steps = buffers.size();
+        shape = first.shape;
+    }
+    if (steps == 0)
+        throw std::runtime_error("No volumes in the sequence");
+
+    size_t components = shape.size() == 3 ? 1 : shape[3];
+    auto dataFormat = getDataFormat(first, components);
+    validateTimer.stop();
+
+    // Each step is described in the index order of prepareVolume
+    auto dimensions = size3_t(shape[1], shape[0], shape[2]);
+    size_t stepSize = 1;
+    for (auto extent : shape)
+        stepSize *= extent;
+    const size_t stepBytes = first.itemsize * stepSize;
+
+    std::unique_ptr<ValueStatsVisitor> statsVisitor;
+    if (options.valueRange || options.bins > 0)
+        statsVisitor = ValueStatsVisitor::create(dataFormat, options.bins);
+
+    // All steps share one arena, borrowed from a single writable buffer if allowed. Borrowed
+    // memory may be backed by a file, so upcoming steps are read ahead during playback. Copies are
+    // placed in a scratch file if there is a memory budget, which spills steps that are not shown.
+    char* arena;
+    std::shared_ptr<void> owner;
+    std::shared_ptr<ScratchMemory> scratch;
+    const bool borrow = buffers.size() == 1 && !options.copy && first.isBorrowable();
+    if (borrow) {
+        IngestStats::getPtr().addBorrow();
+        arena = static_cast<char*>(const_cast<void*>(first.data));
+        owner = first.owner;
+        if (statsVisitor)
+            statsVisitor->scan(arena, steps * stepBytes);
+    } else {
+        PhaseTimer allocateTimer(IngestPhase::Allocate);
+        IngestStats::getPtr().addAllocation();
+        auto& budget = MemoryBudget::getPtr();
+        if (budget.getLimit() > 0 && stepBytes > 0) {
+            scratch = budget.allocateScratch(steps * stepBytes);
+            arena = static_cast<char*>(scratch->getData());
+            owner = scratch;
+        } else {
+            auto memory = budget.allocate(steps * stepBytes);
+            arena = static_cast<char*>(memory->getData());
+            owner = memory;
+        }
+        allocateTimer.stop();
+
+        PhaseTimer copyTimer(IngestPhase::Copy);
+        IngestStats::getPtr().addBytesCopied(steps * stepBytes);
+        if (buffers.size() == 1) {
+            copyStrided(first.data, first.strides, arena,
+                        getPackedStrides(first.shape, first.itemsize), first.shape,
+                        first.itemsize, statsVisitor.get());
+        } else {
+            auto strides = getPackedStrides(shape, first.itemsize);
+            for (size_t i = 0; i < steps; ++i)
+                copyStrided(buffers[i].data, buffers[i].strides, arena + i * stepBytes, strides,
+                            shape, first.itemsize, statsVisitor.get());
+        }
+    }
+
+    // All steps get the range of the whole sequence, so it does not change during playback
+    DataMapper dataMap(dataFormat);
+    if (statsVisitor) {
+        auto stats = statsVisitor->finish(arena, steps * stepBytes);
+        dataMap.dataRange = stats.range;
+        dataMap.valueRange = stats.range;
+    }
+
+    auto sequence = std::make_shared<VolumeSequence>();
+    for (size_t i = 0; i < steps; ++i) {
+        IngestStats::getPtr().addVolume();
+        auto volumeRAM =
+            createVolumeRAMBuffer(dimensions, dataFormat, arena + i * stepBytes, owner);
+        if (!volumeRAM)
+            throw std::runtime_error("Cannot wrap volume buffer");
+        auto volume = std::make_shared<Volume>(volumeRAM);
+        volume->dataMap_ = dataMap;
+        sequence->push_back(volume);
+    }
+    sequenceSource.with([&](VolumeSequenceSourceBuffer* source) {
+        source->setData(sequence, borrow || scratch != nullptr, scratch);
+    });
+}
+
+template <typename Access>
+void mapVolumeSequenceT(const Access& sequenceSource, const std::string& path, NumericType type,
+                        size_t itemsize, const std::vector<size_t>& shape, size_t offset,
+                        const IngestOptions& options) {
+    // Pages are read when a step is first shown, or ahead of it during playback
+    BufferView buffer;
+    auto file = mapBuffer(path, type, itemsize, shape, offset, buffer);
+    if (options.valueRange || options.bins > 0)
+        file->adviseSequential();
+
+    IngestOptions borrow(options);
+    borrow.copy = false;
+    setVolumeSequenceT(sequenceSource, {buffer}, borrow);
+}
+
+template <typename Access>
+void setMeshT(const Access& meshSource, const std::vector<MeshAttribute>& attributes,
+              bool replace) {
+    PhaseTimer validateTimer(IngestPhase::Validate);
+
+    // Attributes replacing those of the current mesh must also match its number of vertices,
+    // which the source checks against the meshes set before that may not be handed over yet
+    size_t count = 0;
+    bool positions = false;
+    for (const auto& attribute : attributes) {
+        const auto& buffer = attribute.second;
+        if (buffer.shape.size() < 1 || buffer.shape.size() > 2)
+            throw std::runtime_error("Incompatible buffer dimensions (expected 1 or 2)");
+        if (count == 0)
+            count = buffer.shape[0];
+        else if (buffer.shape[0] != count)
+            throw std::runtime_error("Attributes must have one element per vertex");
+        positions = positions || attribute.first == BufferType::PositionAttrib;
+    }
+    if (replace && !positions)
+        throw std::runtime_error("A new mesh needs positions");
+    validateTimer.stop();
+
+    // Buffer representations own their data, so every attribute is copied once
+    MeshSourceBuffer::Buffers buffers;
+    for (const auto& attribute : attributes) {
+        const auto& buffer = attribute.second;
+        const size_t components = buffer.shape.size() == 1 ? 1 : buffer.shape[1];
+        auto dataFormat = getDataFormat(buffer, components);
+
+        PhaseTimer allocateTimer(IngestPhase::Allocate);
+        IngestStats::getPtr().addAllocation();
+        auto meshBuffer = createBuffer(dataFormat, buffer.shape[0]);
+        if (!meshBuffer)
+            throw std::runtime_error("Data format not supported");
+        auto bufferRAM = meshBuffer->getEditableRepresentation<BufferRAM>();
+        allocateTimer.stop();
+
+        PhaseTimer copyTimer(IngestPhase::Copy);
+        IngestStats::getPtr().addBytesCopied(buffer.itemsize * buffer.getSize());
+        copyStrided(buffer.data, buffer.strides, bufferRAM->getData(),
+                    getPackedStrides(buffer.shape, buffer.itemsize), buffer.shape,
+                    buffer.itemsize);
+        buffers[attribute.first] = meshBuffer;
+    }
+    meshSource.with([&](MeshSourceBuffer* source) { source->setData(buffers, replace); });
+}
+
+template <typename Access>
+void updateVolumeRegionT(const Access& volumeSource, const BufferView& buffer,
+                         const std::vector<size_t>& offset) {
+    auto volume =
+        volumeSource.with([](VolumeSourceBuffer* source) { return source->getVolume(); });
+    if (!volume)
+        throw std::runtime_error("No volume to update, set a volume first");
+
+    // The region is validated against the current volume and packed here, the volume itself is
+    // only written on the main thread. The caller may reuse the buffer once this returns.
+    PhaseTimer validateTimer(IngestPhase::Validate);
+    validateRegion(buffer, offset, volume->getDimensions(), volume->getDataFormat());
+    const auto range =
+        getValueRange(buffer.data, buffer.strides, buffer.type, buffer.itemsize, buffer.shape);
+    validateTimer.stop();
+
+    PhaseTimer copyTimer(IngestPhase::Copy);
+    IngestStats::getPtr().addBytesCopied(buffer.itemsize * buffer.getSize());
+    auto region = std::make_shared<std::vector<char>>(buffer.itemsize * buffer.getSize());
+    BufferView packed = buffer;
+    packed.data = region->data();
+    packed.strides = getPackedStrides(buffer.shape, buffer.itemsize);
+    packed.owner = region;
+    packed.writable = true;
+    copyStrided(buffer.data, buffer.strides, region->data(), packed.strides, buffer.shape,
+                buffer.itemsize);
+    copyTimer.stop();
+
+    auto write = [packed, offset](VolumeRAM* volumeRAM) {
+        copyToRegion(packed, offset, volumeRAM->getData(), volumeRAM->getDimensions(),
+                     volumeRAM->getDataFormat());
+    };
+    volumeSource.with([&](VolumeSourceBuffer* source) {
+        source->updateRegion(size3_t(offset[1], offset[0], offset[2]),
+                             size3_t(buffer.shape[1], buffer.shape[0], buffer.shape[2]), range,
+                             write);
+    });
+}
+
+} // namespace
+
+size_t BufferView::getSize() const {
+    size_t size = 1;
+    for (auto extent : shape)
+        size *= extent;
+    return size;
+}
+
+bool BufferView::isPacked() const {
+    return strides == getPackedStrides(shape, itemsize);
+}
+
+bool BufferView::isBorrowable() const {
+    return writable && isPacked() && reinterpret_cast<std::uintptr_t>(data) % itemsize == 0;
+}
+
+std::shared_ptr<Image> prepareImage(ImageSourceBuffer* imageSource, const BufferView& buffer,
+                                    const IngestOptions& options) {
+    return prepareImageT(DirectAccess<ImageSourceBuffer>{imageSource}, buffer, options);
+}
+
+std::shared_ptr<Image> prepareImage(ProcessorHandle<ImageSourceBuffer>& imageSource,
+                                    const BufferView& buffer, const IngestOptions& options) {
+    return prepareImageT(HandleAccess<ImageSourceBuffer>{imageSource}, buffer, options);
+}
+
+std::shared_ptr<Volume> prepareVolume(VolumeSourceBuffer* volumeSource, const BufferView& buffer,
+                                      const IngestOptions& options,
+                                      std::shared_ptr<const ValueStats>& stats) {
+    return prepareVolumeT(DirectAccess<VolumeSourceBuffer>{volumeSource}, buffer, options,
+                          stats);
+}
+
+std::shared_ptr<Volume> prepareVolume(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                                      const BufferView& buffer, const IngestOptions& options,
+                                      std::shared_ptr<const ValueStats>& stats) {
+    return prepareVolumeT(HandleAccess<VolumeSourceBuffer>{volumeSource}, buffer, options,
+                          stats);
+}
+
+void setImage(ImageSourceBuffer* imageSource, const BufferView& buffer,
+              const IngestOptions& options) {
+    setImageT(DirectAccess<ImageSourceBuffer>{imageSource}, buffer, options);
+}
+
+void setImage(ProcessorHandle<ImageSourceBuffer>& imageSource, const BufferView& buffer,
+              const IngestOptions& options) {
+    setImageT(HandleAccess<ImageSourceBuffer>{imageSource}, buffer, options);
+}
+
+void setVolume(VolumeSourceBuffer* volumeSource, const BufferView& buffer,
+               const IngestOptions& options) {
+    setVolumeT(DirectAccess<VolumeSourceBuffer>{volumeSource}, buffer, options);
+}
+
+void setVolume(ProcessorHandle<VolumeSourceBuffer>& volumeSource, const BufferView& buffer,
+               const IngestOptions& options) {
+    setVolumeT(HandleAccess<VolumeSourceBuffer>{volumeSource}, buffer, options);
+}
+
+void mapVolume(VolumeSourceBuffer* volumeSource, const std::string& path, NumericType type,
+               size_t itemsize, const std::vector<size_t>& shape, size_t offset, bool prefetch,
+               const IngestOptions& options) {
+    mapVolumeT(DirectAccess<VolumeSourceBuffer>{volumeSource}, path, type, itemsize, shape,
+               offset, prefetch, options);
+}
+
+void mapVolume(ProcessorHandle<VolumeSourceBuffer>& volumeSource, const std::string& path,
+               NumericType type, size_t itemsize, const std::vector<size_t>& shape,
+               size_t offset, bool prefetch, const IngestOptions& options) {
+    mapVolumeT(HandleAccess<VolumeSourceBuffer>{volumeSource}, path, type, itemsize, shape,
+               offset, prefetch, options);
+}
+
+void setVolumeSequence(VolumeSequenceSourceBuffer* sequenceSource,
+                       const std::vector<BufferView>& buffers, const IngestOptions& options) {
+    setVolumeSequenceT(DirectAccess<VolumeSequenceSourceBuffer>{sequenceSource}, buffers,
+                       options);
+}
+
+void setVolumeSequence(ProcessorHandle<VolumeSequenceSourceBuffer>& sequenceSource,
+                       const std::vector<BufferView>& buffers, const IngestOptions& options) {
+    setVolumeSequenceT(HandleAccess<VolumeSequenceSourceBuffer>{sequenceSource}, buffers,
+                       options);
+}
+
+void mapVolumeSequence(VolumeSequenceSourceBuffer* sequenceSource, const std::string& path,
+                       NumericType type, size_t itemsize, const std::vector<size_t>& shape,
+                       size_t offset, const IngestOptions& options) {
+    mapVolumeSequenceT(DirectAccess<VolumeSequenceSourceBuffer>{sequenceSource}, path, type,
+                       itemsize, shape, offset, options);
+}
+
+void mapVolumeSequence(ProcessorHandle<VolumeSequenceSourceBuffer>& sequenceSource,
+                       const std::string& path, NumericType type, size_t itemsize,
+                       const std::vector<size_t>& shape, size_t offset,
+                       const IngestOptions& options) {
+    mapVolumeSequenceT(HandleAccess<VolumeSequenceSourceBuffer>{sequenceSource}, path, type,
+                       itemsize, shape, offset, options);
+}
+
+void setMesh(MeshSourceBuffer* meshSource, const std::vector<MeshAttribute>& attributes,
+             bool replace) {
+    setMeshT(DirectAccess<MeshSourceBuffer>{meshSource}, attributes, replace);
+}
+
+void setMesh(ProcessorHandle<MeshSourceBuffer>& meshSource,
+             const std::vector<MeshAttribute>& attributes, bool replace) {
+    setMeshT(HandleAccess<MeshSourceBuffer>{meshSource}, attributes, replace);
+}
+
+void updateVolumeRegion(VolumeSourceBuffer* volumeSource, const BufferView& buffer,
+                        const std::vector<size_t>& offset) {
+    updateVolumeRegionT(DirectAccess<VolumeSourceBuffer>{volumeSource}, buffer, offset);
+}
+
+void updateVolumeRegion(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                        const BufferView& buffer, const std::vector<size_t>& offset) {
+    updateVolumeRegionT(HandleAccess<VolumeSourceBuffer>{volumeSource}, buffer, offset);
+}
+
+VolumeBuilder::VolumeBuilder(VolumeSourceBuffer* volumeSource, NumericType type,
+                             size_t itemsize, const std::vector<size_t>& shape)
+    : data_(nullptr), pushing_(0), committed_(false) {
+    if (shape.size() < 3 || shape.size() > 4)
+        throw std::runtime_error("Incompatible volume dimensions (expected 3 or 4)");
+    BufferView layout;
+    layout.type = type;
+    layout.itemsize = itemsize;
+    auto dataFormat = getDataFormat(layout, shape.size() == 3 ? 1 : shape[3]);
+
+    // Chunks are written straight into the volume, see prepareVolume for the index order
+    PhaseTimer allocateTimer(IngestPhase::Allocate);
+    volume_ = volumeSource->getPooledVolume(size3_t(shape[1], shape[0], shape[2]), dataFormat);
+    data_ = volume_->getEditableRepresentation<VolumeRAM>()->getData();
+}
+
+void VolumeBuilder::push(const BufferView& chunk, const std::vector<size_t>& offset) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (committed_)
+            throw std::runtime_error("Volume has already been committed");
+        ++pushing_;
+    }
+
+    // Chunks may be pushed concurrently, each one only writes to its own region
+    struct Done {
+        VolumeBuilder& builder;
+        ~Done() {
+            {
+                std::lock_guard<std::mutex> lock(builder.mutex_);
+                --builder.pushing_;
+            }
+            builder.idle_.notify_all();
+        }
+    } done{*this};
+    copyToRegion(chunk, offset, data_, volume_->getDimensions(), volume_->getDataFormat());
+}
+
+void VolumeBuilder::commit(VolumeSourceBuffer* volumeSource, const IngestOptions& options) {
+    auto stats = finish(options);
+    // The builder lets go of the volume, it is only referenced by the processor from now on
+    volumeSource->setData(std::move(volume_), stats);
+    data_ = nullptr;
+}
+
+void VolumeBuilder::commit(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                           const IngestOptions& options) {
+    auto stats = finish(options);
+    HandleAccess<VolumeSourceBuffer>{volumeSource}.with([&](VolumeSourceBuffer* source) {
+        source->setData(std::move(volume_), stats);
+    });
+    data_ = nullptr;
+}
+
+std::shared_ptr<const ValueStats> VolumeBuilder::finish(const IngestOptions& options) {
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (committed_)
+            throw std::runtime_error("Volume has already been committed");
+        committed_ = true;
+        idle_.wait(lock, [this]() { return pushing_ == 0; });
+    }
+    IngestStats::getPtr().addVolume();
+
+    std::shared_ptr<const ValueStats> stats;
+    if (options.valueRange || options.bins > 0) {
+        auto dataFormat = volume_->getDataFormat();
+        const size_t bytes = dataFormat->getSize() * glm::compMul(volume_->getDimensions());
+        auto statsVisitor = ValueStatsVisitor::create(dataFormat, options.bins);
+        statsVisitor->scan(data_, bytes);
+        auto valueStats = std::make_shared<ValueStats>(statsVisitor->finish(data_, bytes));
+        volume_->dataMap_.dataRange = valueStats->range;
+        volume_->dataMap_.valueRange = valueStats->range;
+        stats = valueStats;
+    }
+    return stats;
+}
+
+bool VolumeBuilder::isCommitted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return committed_;
+}
+
+} // namespace
+
+} // namespace
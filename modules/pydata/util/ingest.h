@@ -0,0 +1,282 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_INGEST_H
+#define IVW_PYDATA_INGEST_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/datastructures/geometry/geometrytype.h>
+#include <inviwo/core/datastructures/image/image.h>
+#include <inviwo/core/datastructures/volume/volume.h>
+#include <modules/pydata/util/processorhandle.h>
+#include <modules/pydata/util/valuestats.h>
+
+#include <condition_variable>
+#include <mutex>
+
+namespace inviwo {
+
+class ImageSourceBuffer;
+class MeshSourceBuffer;
+class VolumeSequenceSourceBuffer;
+class VolumeSourceBuffer;
+
+namespace pydata {
+
+/**
+ * A strided n-dimensional buffer to be ingested, described in the index order of the producer,
+ * i.e. (rows, columns[, components]) for images and (rows, columns, slices[, components]) for
+ * volumes. The optional owner keeps the data alive if it is borrowed by a representation.
+ * Borrowing representations are editable, so only writable memory is borrowed.
+ */
+struct IVW_MODULE_PYDATA_API BufferView {
+    BufferView()
+        : data(nullptr), type(NumericType::NotSpecialized), itemsize(0), writable(false) {}
+
+    const void* data;
+    NumericType type;
+    size_t itemsize;                      ///< Bytes per component
+    std::vector<size_t> shape;
+    std::vector<std::ptrdiff_t> strides;  ///< Byte strides, may be negative
+    std::shared_ptr<void> owner;
+    bool writable;                        ///< True if the memory may be written to
+
+    size_t getSize() const;      ///< Number of components in the buffer
+    bool isPacked() const;       ///< True if stored packed in row-major order
+    bool isBorrowable() const;   ///< True if writable, packed and aligned, see IngestOptions::copy
+};
+
+/**
+ * A mesh attribute, described as (vertices[, components])
+ */
+using MeshAttribute = std::pair<BufferType, BufferView>;
+
+/**
+ * Options for how a buffer is ingested
+ */
+struct IVW_MODULE_PYDATA_API IngestOptions {
+    IngestOptions(bool copy = true)
+        : copy(copy)
+        , valueRange(false)
+        , bins(0)
+        , targetType(NumericType::NotSpecialized)
+        , targetItemsize(0)
+        , autoScale(true)
+        , scale(1.0)
+        , offset(0.0) {}
+
+    /// Copy the buffer, or borrow its memory if the layout allows it and it is writable.
+    /// Read-only buffers are always copied. Borrowed memory is not counted against the
+    /// MemoryBudget.
+    bool copy;
+    bool valueRange;  ///< Compute the value range of volumes and set it in the data map
+    size_t bins;      ///< Compute a histogram of volumes with this many bins, implies valueRange
+
+    /// Convert volumes to float32 or float16, or quantize them to uint8 or uint16, while copying.
+    /// NotSpecialized keeps the type of the buffer.
+    NumericType targetType;
+    size_t targetItemsize;  ///< Bytes per component of the target type
+    /// Fit scale and offset of integer targets to the value range, which takes an extra pass
+    /// over the buffer. Float targets keep the values as they are.
+    bool autoScale;
+    double scale;   ///< Step of the stored values unless autoScale, value = stored * scale + offset
+    double offset;  ///< Value of stored 0 unless autoScale
+};
+
+/**
+ * Create an image for the processor from the buffer, reusing an image from the processor pool
+ * when copying. Does not touch the network and may be called from any thread.
+ * The overload taking a processor handle only locks it to take an image from the pool, not
+ * while copying.
+ */
+IVW_MODULE_PYDATA_API std::shared_ptr<Image> prepareImage(ImageSourceBuffer* imageSource,
+                                                          const BufferView& buffer,
+                                                          const IngestOptions& options);
+IVW_MODULE_PYDATA_API std::shared_ptr<Image> prepareImage(
+    ProcessorHandle<ImageSourceBuffer>& imageSource, const BufferView& buffer,
+    const IngestOptions& options);
+
+/**
+ * Create a volume for the processor from the buffer, reusing a volume from the processor pool
+ * when copying. Value statistics are computed while copying if requested and returned in stats.
+ * Does not touch the network and may be called from any thread.
+ * The overload taking a processor handle only locks it to take a volume from the pool, not
+ * while copying.
+ */
+IVW_MODULE_PYDATA_API std::shared_ptr<Volume> prepareVolume(
+    VolumeSourceBuffer* volumeSource, const BufferView& buffer, const IngestOptions& options,
+    std::shared_ptr<const ValueStats>& stats);
+IVW_MODULE_PYDATA_API std::shared_ptr<Volume> prepareVolume(
+    ProcessorHandle<VolumeSourceBuffer>& volumeSource, const BufferView& buffer,
+    const IngestOptions& options, std::shared_ptr<const ValueStats>& stats);
+
+/**
+ * Create an image from the buffer and set it as the data of the processor.
+ * The overload taking a processor handle only locks it to take a buffer from the pool and to
+ * hand the data over, not while copying. It throws if the processor is removed meanwhile.
+ */
+IVW_MODULE_PYDATA_API void setImage(ImageSourceBuffer* imageSource, const BufferView& buffer,
+                                    const IngestOptions& options);
+IVW_MODULE_PYDATA_API void setImage(ProcessorHandle<ImageSourceBuffer>& imageSource,
+                                    const BufferView& buffer, const IngestOptions& options);
+
+/**
+ * Create a volume from the buffer and set it as the data of the processor.
+ * The overload taking a processor handle only locks it to take a buffer from the pool and to
+ * hand the data over, not while copying. It throws if the processor is removed meanwhile.
+ */
+IVW_MODULE_PYDATA_API void setVolume(VolumeSourceBuffer* volumeSource, const BufferView& buffer,
+                                     const IngestOptions& options);
+IVW_MODULE_PYDATA_API void setVolume(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                                     const BufferView& buffer, const IngestOptions& options);
+
+/**
+ * Map shape.size() dimensional raw data of the given type from a file, starting offset bytes
+ * into it, and set it as the volume of the processor. Nothing is read up front, pages are read
+ * when first touched and writes to the volume are not written back to the file. If prefetch is
+ * set, the whole range is read ahead in the background. The copy option is ignored, and the
+ * mapping is not counted against the MemoryBudget. A processor handle is only locked to hand
+ * the volume over, not while the value statistics are computed.
+ */
+IVW_MODULE_PYDATA_API void mapVolume(VolumeSourceBuffer* volumeSource, const std::string& path,
+                                     NumericType type, size_t itemsize,
+                                     const std::vector<size_t>& shape, size_t offset,
+                                     bool prefetch, const IngestOptions& options);
+IVW_MODULE_PYDATA_API void mapVolume(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                                     const std::string& path, NumericType type, size_t itemsize,
+                                     const std::vector<size_t>& shape, size_t offset,
+                                     bool prefetch, const IngestOptions& options);
+
+/**
+ * Create a sequence of volumes from a (steps, rows, columns, slices[, components]) buffer, or
+ * from a list of buffers holding one step each, and set it as the data of the processor. The
+ * steps are stored one after another in one allocation, or borrowed from a single buffer if the
+ * copy option is off and the layout allows it. If a memory budget is set, the allocation is
+ * backed by a scratch file so that steps not shown can be spilled. Conversion options are
+ * ignored, and the value range is computed over all steps. A processor handle is only locked
+ * to hand the sequence over.
+ */
+IVW_MODULE_PYDATA_API void setVolumeSequence(VolumeSequenceSourceBuffer* sequenceSource,
+                                             const std::vector<BufferView>& buffers,
+                                             const IngestOptions& options);
+IVW_MODULE_PYDATA_API void setVolumeSequence(
+    ProcessorHandle<VolumeSequenceSourceBuffer>& sequenceSource,
+    const std::vector<BufferView>& buffers, const IngestOptions& options);
+
+/**
+ * Map a sequence of volumes stored one after another in a raw file, see mapVolume. The shape is
+ * given in the index order of setVolumeSequence.
+ */
+IVW_MODULE_PYDATA_API void mapVolumeSequence(VolumeSequenceSourceBuffer* sequenceSource,
+                                             const std::string& path, NumericType type,
+                                             size_t itemsize, const std::vector<size_t>& shape,
+                                             size_t offset, const IngestOptions& options);
+IVW_MODULE_PYDATA_API void mapVolumeSequence(
+    ProcessorHandle<VolumeSequenceSourceBuffer>& sequenceSource, const std::string& path,
+    NumericType type, size_t itemsize, const std::vector<size_t>& shape, size_t offset,
+    const IngestOptions& options);
+
+/**
+ * Create a buffer from each attribute and set them as the data of the processor. If replace is
+ * set the mesh only has the given attributes, which must include positions. Otherwise they
+ * replace attributes of the same type and must have as many vertices as the current mesh,
+ * including meshes set from other threads that are not handed over yet. A processor handle is
+ * only locked to hand the buffers over.
+ */
+IVW_MODULE_PYDATA_API void setMesh(MeshSourceBuffer* meshSource,
+                                   const std::vector<MeshAttribute>& attributes, bool replace);
+IVW_MODULE_PYDATA_API void setMesh(ProcessorHandle<MeshSourceBuffer>& meshSource,
+                                   const std::vector<MeshAttribute>& attributes, bool replace);
+
+/**
+ * Write the buffer into a sub-box of the current volume of the processor. The offset is given
+ * in the index order of the buffer. The region is validated and copied on the calling thread and
+ * written into the volume on the main thread, see VolumeSourceBuffer::updateRegion. A borrowed
+ * or mapped volume is copied first, so the buffer it was created from is never written to. A
+ * processor handle is not locked while the region is copied.
+ */
+IVW_MODULE_PYDATA_API void updateVolumeRegion(VolumeSourceBuffer* volumeSource,
+                                              const BufferView& buffer,
+                                              const std::vector<size_t>& offset);
+IVW_MODULE_PYDATA_API void updateVolumeRegion(ProcessorHandle<VolumeSourceBuffer>& volumeSource,
+                                              const BufferView& buffer,
+                                              const std::vector<size_t>& offset);
+
+/**
+ * \class VolumeBuilder
+ * \brief Assembles a volume of the processor from chunks written into it in place
+ * The volume is taken from the pool of the processor up front. Chunks may be pushed from several
+ * threads at once, as long as their regions do not overlap, and commit hands the volume over
+ * without copying it. Voxels that no chunk was written to are undefined.
+ */
+class IVW_MODULE_PYDATA_API VolumeBuilder {
+public:
+    /**
+     * Begin a volume with the given shape in the index order of prepareVolume
+     */
+    VolumeBuilder(VolumeSourceBuffer* volumeSource, NumericType type, size_t itemsize,
+                  const std::vector<size_t>& shape);
+    VolumeBuilder(const VolumeBuilder&) = delete;
+    VolumeBuilder& operator=(const VolumeBuilder&) = delete;
+
+    /**
+     * Write the chunk into the volume, with the offset given in the index order of the chunk.
+     * May be called from any thread.
+     */
+    void push(const BufferView& chunk, const std::vector<size_t>& offset);
+
+    /**
+     * Wait for chunks being pushed and set the volume as the data of the processor. The value
+     * range and histogram options are applied, other options are ignored. A processor handle is
+     * only locked to hand the volume over.
+     */
+    void commit(VolumeSourceBuffer* volumeSource, const IngestOptions& options);
+    void commit(ProcessorHandle<VolumeSourceBuffer>& volumeSource, const IngestOptions& options);
+
+    bool isCommitted() const;
+
+private:
+    // Wait for chunks being pushed and return the value statistics of the volume, if requested
+    std::shared_ptr<const ValueStats> finish(const IngestOptions& options);
+
+    std::shared_ptr<Volume> volume_;
+    void* data_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    size_t pushing_;  // Number of chunks being written
+    bool committed_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_INGEST_H
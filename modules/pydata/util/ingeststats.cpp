@@ -0,0 +1,114 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/ingeststats.h>
+
+namespace inviwo {
+
+namespace pydata {
+
+const char* getIngestPhaseName(IngestPhase phase) {
+    switch (phase) {
+        case IngestPhase::Lookup: return "lookup";
+        case IngestPhase::Validate: return "validate";
+        case IngestPhase::Allocate: return "allocate";
+        case IngestPhase::Copy: return "copy";
+        case IngestPhase::Handover: return "handover";
+        case IngestPhase::Evaluate: return "evaluate";
+        default: return "unknown";
+    }
+}
+
+IngestStats::IngestStats() { reset(); }
+
+IngestStats& IngestStats::getPtr() {
+    static IngestStats stats;
+    return stats;
+}
+
+void IngestStats::record(IngestPhase phase, std::chrono::steady_clock::duration duration) {
+    auto& counters = phases_[static_cast<size_t>(phase)];
+    const std::int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.total.fetch_add(ns, std::memory_order_relaxed);
+    auto max = counters.max.load(std::memory_order_relaxed);
+    while (ns > max && !counters.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+
+    // The bin is the number of bits of the duration in whole microseconds
+    size_t bin = 0;
+    for (auto us = ns / 1000; us > 0 && bin + 1 < histogramBins; us >>= 1)
+        ++bin;
+    counters.histogram[bin].fetch_add(1, std::memory_order_relaxed);
+}
+
+IngestStats::Snapshot IngestStats::getSnapshot() const {
+    Snapshot snapshot;
+    snapshot.images = images_.load(std::memory_order_relaxed);
+    snapshot.volumes = volumes_.load(std::memory_order_relaxed);
+    snapshot.bytesCopied = bytesCopied_.load(std::memory_order_relaxed);
+    snapshot.allocations = allocations_.load(std::memory_order_relaxed);
+    snapshot.reuses = reuses_.load(std::memory_order_relaxed);
+    snapshot.borrows = borrows_.load(std::memory_order_relaxed);
+    snapshot.dropped = dropped_.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < phases_.size(); ++i) {
+        const auto& counters = phases_[i];
+        auto& phase = snapshot.phases[i];
+        phase.count = counters.count.load(std::memory_order_relaxed);
+        phase.total = counters.total.load(std::memory_order_relaxed) * 1e-9;
+        phase.max = counters.max.load(std::memory_order_relaxed) * 1e-9;
+        for (size_t bin = 0; bin < histogramBins; ++bin)
+            phase.histogram[bin] = counters.histogram[bin].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+void IngestStats::reset() {
+    images_ = 0;
+    volumes_ = 0;
+    bytesCopied_ = 0;
+    allocations_ = 0;
+    reuses_ = 0;
+    borrows_ = 0;
+    dropped_ = 0;
+
+    for (auto& counters : phases_) {
+        counters.count = 0;
+        counters.total = 0;
+        counters.max = 0;
+        for (auto& bin : counters.histogram)
+            bin = 0;
+    }
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,158 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_INGESTSTATS_H
+#define IVW_PYDATA_INGESTSTATS_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Phases of the ingest path that are timed separately
+ */
+enum class IngestPhase {
+    Lookup,    ///< Finding the source processor in the network
+    Validate,  ///< Checking the shape and format of the buffer against the target
+    Allocate,  ///< Getting the target data from the pool, or allocating it
+    Copy,      ///< Copying the buffer into the target data
+    Handover,  ///< Setting the data of the outport and invalidating the network
+    Evaluate,  ///< From the handover until the source processor is processed
+    Count
+};
+
+IVW_MODULE_PYDATA_API const char* getIngestPhaseName(IngestPhase phase);
+
+/**
+ * \class IngestStats
+ * \brief Process wide counters and latency histograms of the ingest path
+ * All updates are relaxed atomic operations, so the instrumentation can stay on in release
+ * builds. Histogram bin i counts durations in [2^(i-1), 2^i) microseconds, bin 0 durations
+ * below one microsecond and the last bin everything longer.
+ */
+class IVW_MODULE_PYDATA_API IngestStats {
+public:
+    static const size_t histogramBins = 24;
+
+    struct Phase {
+        size_t count;
+        double total;  ///< Seconds
+        double max;    ///< Seconds
+        std::array<size_t, histogramBins> histogram;
+    };
+
+    struct Snapshot {
+        size_t images;       ///< Images set
+        size_t volumes;      ///< Volumes set
+        size_t bytesCopied;
+        size_t allocations;  ///< Pool misses that allocated new data
+        size_t reuses;       ///< Pool hits
+        size_t borrows;      ///< Buffers used without copying
+        size_t dropped;      ///< Frames replaced by a newer one before they were handed over
+        std::array<Phase, static_cast<size_t>(IngestPhase::Count)> phases;
+    };
+
+    static IngestStats& getPtr();
+
+    void record(IngestPhase phase, std::chrono::steady_clock::duration duration);
+
+    void addImage() { images_.fetch_add(1, std::memory_order_relaxed); }
+    void addVolume() { volumes_.fetch_add(1, std::memory_order_relaxed); }
+    void addBytesCopied(size_t bytes) { bytesCopied_.fetch_add(bytes, std::memory_order_relaxed); }
+    void addAllocation() { allocations_.fetch_add(1, std::memory_order_relaxed); }
+    void addReuse() { reuses_.fetch_add(1, std::memory_order_relaxed); }
+    void addBorrow() { borrows_.fetch_add(1, std::memory_order_relaxed); }
+    void addDropped() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+    /**
+     * Return the current values. Counters are read one by one, so a snapshot taken during
+     * ingest may be off by the calls in flight.
+     */
+    Snapshot getSnapshot() const;
+
+    void reset();
+
+private:
+    IngestStats();
+
+    struct PhaseCounters {
+        std::atomic<size_t> count;
+        std::atomic<std::int64_t> total;  // Nanoseconds
+        std::atomic<std::int64_t> max;    // Nanoseconds
+        std::array<std::atomic<size_t>, histogramBins> histogram;
+    };
+
+    std::atomic<size_t> images_;
+    std::atomic<size_t> volumes_;
+    std::atomic<size_t> bytesCopied_;
+    std::atomic<size_t> allocations_;
+    std::atomic<size_t> reuses_;
+    std::atomic<size_t> borrows_;
+    std::atomic<size_t> dropped_;
+    std::array<PhaseCounters, static_cast<size_t>(IngestPhase::Count)> phases_;
+};
+
+/**
+ * \class PhaseTimer
+ * \brief Records the time from construction to destruction, or to stop, as an ingest phase
+ */
+class PhaseTimer {
+public:
+    PhaseTimer(IngestPhase phase)
+        : phase_(phase), start_(std::chrono::steady_clock::now()), running_(true) {}
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    ~PhaseTimer() { stop(); }
+
+    void stop() {
+        if (running_) {
+            IngestStats::getPtr().record(phase_, std::chrono::steady_clock::now() - start_);
+            running_ = false;
+        }
+    }
+
+private:
+    IngestPhase phase_;
+    std::chrono::steady_clock::time_point start_;
+    bool running_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_INGESTSTATS_H
@@ -0,0 +1,334 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/memorybudget.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// An entry for bytes held elsewhere
+class TrackedEntry : public MemoryEntry {
+public:
+    explicit TrackedEntry(size_t size) : MemoryEntry(size) {}
+};
+
+} // namespace
+
+MemoryEntry::MemoryEntry(size_t size) : size_(size), resident_(true) {}
+
+MemoryEntry::~MemoryEntry() { MemoryBudget::getPtr().remove(*this); }
+
+void MemoryEntry::setRelease(std::function<bool()> release) {
+    std::lock_guard<std::mutex> lock(MemoryBudget::getPtr().mutex_);
+    release_ = std::move(release);
+}
+
+void MemoryEntry::touch() { MemoryBudget::getPtr().touch(*this); }
+
+MemoryAllocation::MemoryAllocation(size_t size) : MemoryEntry(size), data_(new char[size]) {}
+
+#ifdef WIN32
+
+ScratchMemory::ScratchMemory(const std::string& directory, size_t size)
+    : data_(nullptr), size_(size), file_(INVALID_HANDLE_VALUE), fileMapping_(nullptr) {
+    char path[MAX_PATH];
+    if (size == 0 || !GetTempFileNameA(directory.c_str(), "ivw", 0, path))
+        throw std::runtime_error("Cannot create scratch file in " + directory);
+
+    // The file is deleted when the last handle to it is closed
+    file_ = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot create scratch file in " + directory);
+
+    const auto size64 = static_cast<std::uint64_t>(size);
+    fileMapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE,
+                                      static_cast<DWORD>(size64 >> 32),
+                                      static_cast<DWORD>(size64 & 0xffffffff), nullptr);
+    data_ = fileMapping_ ? MapViewOfFile(fileMapping_, FILE_MAP_ALL_ACCESS, 0, 0, size) : nullptr;
+    if (!data_) {
+        if (fileMapping_) CloseHandle(fileMapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map scratch file in " + directory);
+    }
+}
+
+ScratchMemory::~ScratchMemory() {
+    UnmapViewOfFile(data_);
+    CloseHandle(fileMapping_);
+    CloseHandle(file_);
+}
+
+void ScratchMemory::spill(size_t offset, size_t size) const {
+    if (offset >= size_)
+        return;
+    auto begin = static_cast<char*>(data_) + offset;
+    size = std::min(size, size_ - offset);
+
+    // Unlocking pages that are not locked removes them from the working set
+    FlushViewOfFile(begin, size);
+    VirtualUnlock(begin, size);
+}
+
+#else
+
+ScratchMemory::ScratchMemory(const std::string& directory, size_t size)
+    : data_(nullptr), size_(size), file_(-1) {
+    std::string path = directory + "/inviwo-pydata-XXXXXX";
+    std::vector<char> name(path.begin(), path.end());
+    name.push_back('\0');
+    file_ = size > 0 ? mkstemp(name.data()) : -1;
+    if (file_ < 0)
+        throw std::runtime_error("Cannot create scratch file in " + directory);
+
+    // The file is deleted when the mapping and the descriptor are closed
+    unlink(name.data());
+    if (ftruncate(file_, static_cast<off_t>(size)) != 0) {
+        close(file_);
+        throw std::runtime_error("Cannot create scratch file in " + directory);
+    }
+    data_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file_, 0);
+    if (data_ == MAP_FAILED) {
+        close(file_);
+        throw std::runtime_error("Cannot map scratch file in " + directory);
+    }
+}
+
+ScratchMemory::~ScratchMemory() {
+    munmap(data_, size_);
+    close(file_);
+}
+
+void ScratchMemory::spill(size_t offset, size_t size) const {
+    if (offset >= size_)
+        return;
+    size = std::min(size, size_ - offset);
+
+    // Only whole pages inside the range are dropped, its ends may share pages with other data
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t begin = (offset + pageSize - 1) / pageSize * pageSize;
+    const size_t end = (offset + size) / pageSize * pageSize;
+    if (begin >= end)
+        return;
+    auto pages = static_cast<char*>(data_) + begin;
+    msync(pages, end - begin, MS_SYNC);
+    madvise(pages, end - begin, MADV_DONTNEED);
+    posix_fadvise(file_, static_cast<off_t>(begin), static_cast<off_t>(end - begin),
+                  POSIX_FADV_DONTNEED);
+}
+
+#endif
+
+MemoryBudget::MemoryBudget()
+    : used_(0), released_(0), limit_(0), evictions_(0), warned_(false), enforceQueued_(false) {}
+
+MemoryBudget& MemoryBudget::getPtr() {
+    static MemoryBudget budget;
+    return budget;
+}
+
+std::shared_ptr<MemoryAllocation> MemoryBudget::allocate(size_t size) {
+    auto allocation = std::make_shared<MemoryAllocation>(size);
+    add(allocation);
+    return allocation;
+}
+
+std::shared_ptr<MemoryEntry> MemoryBudget::track(size_t size, std::function<bool()> release) {
+    std::shared_ptr<MemoryEntry> entry = std::make_shared<TrackedEntry>(size);
+    entry->release_ = std::move(release);
+    add(entry);
+    return entry;
+}
+
+std::shared_ptr<ScratchMemory> MemoryBudget::allocateScratch(size_t size) {
+    return std::make_shared<ScratchMemory>(getScratchDirectory(), size);
+}
+
+void MemoryBudget::add(const std::shared_ptr<MemoryEntry>& entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entry->position_ = entries_.insert(entries_.end(), entry);
+    used_ += entry->size_;
+}
+
+void MemoryBudget::remove(MemoryEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.erase(entry.position_);
+    if (entry.resident_)
+        used_ -= entry.size_;
+    else
+        released_ -= entry.size_;
+}
+
+void MemoryBudget::touch(MemoryEntry& entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.splice(entries_.end(), entries_, entry.position_);
+    if (!entry.resident_) {
+        entry.resident_ = true;
+        released_ -= entry.size_;
+        used_ += entry.size_;
+    }
+}
+
+void MemoryBudget::enforce() {
+    // Release functions free memory, which removes entries, so they are called without the lock
+    std::vector<std::weak_ptr<MemoryEntry>> candidates;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (limit_ == 0 || used_ <= limit_) {
+            warned_ = false;
+            return;
+        }
+        for (auto& weakEntry : entries_) {
+            auto entry = weakEntry.lock();
+            if (entry && entry->resident_ && entry->release_)
+                candidates.push_back(entry);
+        }
+    }
+
+    for (auto& weakEntry : candidates) {
+        auto entry = weakEntry.lock();
+        if (!entry)
+            continue;
+
+        std::function<bool()> release;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (limit_ == 0 || used_ <= limit_)
+                break;
+            if (!entry->resident_)
+                continue;
+            release = entry->release_;
+        }
+        if (!release || !release())
+            continue;
+
+        // Freed entries are removed once the last reference to them is gone
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++evictions_;
+        if (entry->resident_) {
+            entry->resident_ = false;
+            used_ -= entry->size_;
+            released_ += entry->size_;
+        }
+    }
+
+    // Warn once about data in use that keeps the budget exceeded, unless the main thread is
+    // about to release more
+    size_t limit = 0;
+    size_t excess = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (limit_ == 0 || used_ <= limit_) {
+            warned_ = false;
+            return;
+        }
+        if (warned_ || enforceQueued_)
+            return;
+        warned_ = true;
+        limit = limit_;
+        excess = used_ - limit_;
+    }
+    LogWarnCustom("MemoryBudget", "The memory budget of " << (limit >> 20) << " MB is exceeded by "
+                                                          << ((excess + (1 << 20) - 1) >> 20)
+                                                          << " MB of data in use");
+}
+
+void MemoryBudget::enforceOnMainThread() {
+    if (isMainThread()) {
+        enforce();
+        return;
+    }
+    if (enforceQueued_.exchange(true))
+        return;
+    InviwoApplication::getPtr()->dispatchFront([this]() {
+        enforceQueued_ = false;
+        enforce();
+    });
+}
+
+void MemoryBudget::setLimit(size_t limit) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        limit_ = limit;
+    }
+    enforce();
+}
+
+size_t MemoryBudget::getLimit() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return limit_;
+}
+
+void MemoryBudget::setScratchDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    scratchDirectory_ = directory;
+}
+
+std::string MemoryBudget::getScratchDirectory() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!scratchDirectory_.empty())
+        return scratchDirectory_;
+
+#ifdef WIN32
+    char path[MAX_PATH];
+    const auto length = GetTempPathA(MAX_PATH, path);
+    return length > 0 ? std::string(path, length) : std::string(".");
+#else
+    const char* path = std::getenv("TMPDIR");
+    return path && *path ? std::string(path) : std::string("/tmp");
+#endif
+}
+
+MemoryBudget::Usage MemoryBudget::getUsage() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const size_t excess = limit_ > 0 && used_ > limit_ ? used_ - limit_ : 0;
+    return Usage{used_, released_, limit_, excess, entries_.size(), evictions_};
+}
+
+} // namespace
+
+} // namespace
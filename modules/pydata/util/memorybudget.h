@@ -0,0 +1,215 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_MEMORYBUDGET_H
+#define IVW_PYDATA_MEMORYBUDGET_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+
+namespace inviwo {
+
+namespace pydata {
+
+class MemoryBudget;
+
+/**
+ * \class MemoryEntry
+ * \brief Bytes counted against the memory budget for as long as the entry is alive
+ * An entry may have a release function, which the budget calls to free or spill the bytes of
+ * the least recently used entries when it is exceeded. The function returns false if the data
+ * is in use and cannot be released. Data held by processors can only be dropped on the main
+ * thread, its release function may call MemoryBudget::enforceOnMainThread and return false.
+ */
+class IVW_MODULE_PYDATA_API MemoryEntry {
+public:
+    virtual ~MemoryEntry();
+
+    size_t getSize() const { return size_; }
+
+    /**
+     * Set the function releasing the bytes, it is called without any locks of the budget held
+     */
+    void setRelease(std::function<bool()> release);
+
+    /**
+     * Mark the entry as used now. Released bytes are counted again, since data that was spilled
+     * is read back when accessed.
+     */
+    void touch();
+
+protected:
+    explicit MemoryEntry(size_t size);
+
+private:
+    friend class MemoryBudget;
+
+    const size_t size_;
+    bool resident_;
+    std::function<bool()> release_;
+    std::list<std::weak_ptr<MemoryEntry>>::iterator position_;
+};
+
+/**
+ * \class MemoryAllocation
+ * \brief Heap memory counted against the memory budget, freed along with the entry
+ */
+class IVW_MODULE_PYDATA_API MemoryAllocation : public MemoryEntry {
+public:
+    explicit MemoryAllocation(size_t size);
+    virtual ~MemoryAllocation() = default;
+
+    void* getData() const { return data_.get(); }
+
+private:
+    std::unique_ptr<char[]> data_;
+};
+
+/**
+ * \class ScratchMemory
+ * \brief Memory backed by a file in the scratch directory, which is deleted along with it
+ * Ranges can be spilled, which writes them to the file and drops them from memory. They are read
+ * back from the file when next accessed. The memory itself is not counted against the budget.
+ */
+class IVW_MODULE_PYDATA_API ScratchMemory {
+public:
+    ScratchMemory(const std::string& directory, size_t size);
+    ScratchMemory(const ScratchMemory&) = delete;
+    ScratchMemory& operator=(const ScratchMemory&) = delete;
+    ~ScratchMemory();
+
+    void* getData() const { return data_; }
+    size_t getSize() const { return size_; }
+
+    /**
+     * Write the range to the file and drop it from memory
+     */
+    void spill(size_t offset, size_t size) const;
+
+private:
+    void* data_;
+    size_t size_;
+#ifdef WIN32
+    void* file_;
+    void* fileMapping_;
+#else
+    int file_;
+#endif
+};
+
+/**
+ * \class MemoryBudget
+ * \brief Process wide limit on the memory held by data created by the PyData module
+ * Entries are kept in least recently used order. When the tracked bytes exceed the limit,
+ * enforce releases entries from the least recently used end until they fit or no more can be
+ * released. A limit of 0 means no limit. Data in use, e.g. the current frames of the sources,
+ * is never released, so the limit may stay exceeded. This is logged once until the limit is met
+ * again and reported as the excess of the usage.
+ * Only memory the module allocates is tracked: pooled buffers, pyramid levels, gradients and
+ * sequence steps. Data borrowed from Python buffers or mapped from files is owned elsewhere and
+ * is outside the budget.
+ */
+class IVW_MODULE_PYDATA_API MemoryBudget {
+public:
+    struct Usage {
+        size_t used;       ///< Tracked bytes currently in memory
+        size_t released;   ///< Tracked bytes freed or spilled by the budget
+        size_t limit;
+        size_t excess;     ///< Tracked bytes in memory above the limit, held by data in use
+        size_t entries;
+        size_t evictions;  ///< Entries released since the start
+    };
+
+    static MemoryBudget& getPtr();
+
+    /**
+     * Allocate size bytes of heap memory counted against the budget
+     */
+    std::shared_ptr<MemoryAllocation> allocate(size_t size);
+
+    /**
+     * Count size bytes held elsewhere against the budget, released by the given function
+     */
+    std::shared_ptr<MemoryEntry> track(size_t size, std::function<bool()> release);
+
+    /**
+     * Allocate memory in a scratch file, whose ranges may be tracked and spilled
+     */
+    std::shared_ptr<ScratchMemory> allocateScratch(size_t size);
+
+    /**
+     * Release the least recently used entries until the budget is met. Must not be called with
+     * locks held that release functions take.
+     */
+    void enforce();
+
+    /**
+     * Call enforce on the main thread, where release functions can drop data held by
+     * processors. Calls made before it has run are merged into one.
+     */
+    void enforceOnMainThread();
+
+    void setLimit(size_t limit);
+    size_t getLimit() const;
+    void setScratchDirectory(const std::string& directory);
+    std::string getScratchDirectory() const;
+
+    Usage getUsage() const;
+
+private:
+    friend class MemoryEntry;
+
+    MemoryBudget();
+    void add(const std::shared_ptr<MemoryEntry>& entry);
+    void remove(MemoryEntry& entry);
+    void touch(MemoryEntry& entry);
+
+    mutable std::mutex mutex_;
+    std::list<std::weak_ptr<MemoryEntry>> entries_;  // Least recently used first
+    size_t used_;
+    size_t released_;
+    size_t limit_;
+    size_t evictions_;
+    bool warned_;  // The limit could not be met, warned until it is met again
+    std::atomic<bool> enforceQueued_;
+    std::string scratchDirectory_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_MEMORYBUDGET_H
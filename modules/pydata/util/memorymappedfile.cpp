@@ -0,0 +1,166 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/memorymappedfile.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace inviwo {
+
+namespace pydata {
+
+#ifdef WIN32
+
+MemoryMappedFile::MemoryMappedFile(const std::string& path, size_t offset, size_t size)
+    : path_(path)
+    , data_(nullptr)
+    , size_(size)
+    , mapping_(nullptr)
+    , mappingSize_(0)
+    , file_(INVALID_HANDLE_VALUE)
+    , fileMapping_(nullptr) {
+    if (size == 0)
+        throw std::runtime_error("Cannot map an empty range of " + path);
+
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("Cannot open " + path);
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file_, &fileSize) ||
+        static_cast<size_t>(fileSize.QuadPart) < offset + size) {
+        CloseHandle(file_);
+        throw std::runtime_error(path + " is smaller than the mapped range");
+    }
+
+    fileMapping_ = CreateFileMappingA(file_, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (!fileMapping_) {
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map " + path);
+    }
+
+    // The view must start at a multiple of the allocation granularity
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const size_t alignedOffset = offset - offset % info.dwAllocationGranularity;
+    mappingSize_ = size + (offset - alignedOffset);
+    mapping_ = MapViewOfFile(fileMapping_, FILE_MAP_COPY,
+                             static_cast<DWORD>(static_cast<std::uint64_t>(alignedOffset) >> 32),
+                             static_cast<DWORD>(alignedOffset & 0xffffffff), mappingSize_);
+    if (!mapping_) {
+        CloseHandle(fileMapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("Cannot map " + path);
+    }
+    data_ = static_cast<char*>(mapping_) + (offset - alignedOffset);
+}
+
+MemoryMappedFile::~MemoryMappedFile() {
+    UnmapViewOfFile(mapping_);
+    CloseHandle(fileMapping_);
+    CloseHandle(file_);
+}
+
+void prefetchMemory(const void* data, size_t size) {
+    WIN32_MEMORY_RANGE_ENTRY range;
+    range.VirtualAddress = const_cast<void*>(data);
+    range.NumberOfBytes = size;
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+}
+
+void MemoryMappedFile::adviseSequential() const {}
+
+#else
+
+MemoryMappedFile::MemoryMappedFile(const std::string& path, size_t offset, size_t size)
+    : path_(path), data_(nullptr), size_(size), mapping_(nullptr), mappingSize_(0) {
+    if (size == 0)
+        throw std::runtime_error("Cannot map an empty range of " + path);
+
+    int file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("Cannot open " + path);
+
+    struct stat status;
+    if (fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) < offset + size) {
+        close(file);
+        throw std::runtime_error(path + " is smaller than the mapped range");
+    }
+
+    // The mapping must start at a multiple of the page size
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedOffset = offset - offset % pageSize;
+    mappingSize_ = size + (offset - alignedOffset);
+    mapping_ = mmap(nullptr, mappingSize_, PROT_READ | PROT_WRITE, MAP_PRIVATE, file,
+                    static_cast<off_t>(alignedOffset));
+
+    // The mapping keeps its own reference to the file
+    close(file);
+    if (mapping_ == MAP_FAILED)
+        throw std::runtime_error("Cannot map " + path);
+    data_ = static_cast<char*>(mapping_) + (offset - alignedOffset);
+}
+
+MemoryMappedFile::~MemoryMappedFile() { munmap(mapping_, mappingSize_); }
+
+void prefetchMemory(const void* data, size_t size) {
+    // Advice applies to whole pages
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto begin = reinterpret_cast<std::uintptr_t>(data);
+    auto alignedBegin = begin - begin % pageSize;
+    madvise(reinterpret_cast<void*>(alignedBegin), size + (begin - alignedBegin), MADV_WILLNEED);
+}
+
+void MemoryMappedFile::adviseSequential() const {
+    madvise(mapping_, mappingSize_, MADV_SEQUENTIAL);
+}
+
+#endif
+
+void MemoryMappedFile::prefetch(size_t offset, size_t size) const {
+    if (offset >= size_)
+        return;
+    prefetchMemory(static_cast<char*>(data_) + offset, std::min(size, size_ - offset));
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,94 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_MEMORYMAPPEDFILE_H
+#define IVW_PYDATA_MEMORYMAPPEDFILE_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * \class MemoryMappedFile
+ * \brief A private, copy-on-write mapping of a range of a file
+ * Pages are read from the file when first touched, and written pages are private to the
+ * mapping, so data backed by the file can be used as a regular writable buffer without loading
+ * it up front or modifying the file.
+ */
+class IVW_MODULE_PYDATA_API MemoryMappedFile {
+public:
+    /**
+     * Map size bytes starting at offset bytes into the file. Throws if the file cannot be
+     * opened or is too small.
+     */
+    MemoryMappedFile(const std::string& path, size_t offset, size_t size);
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+    ~MemoryMappedFile();
+
+    void* getData() const { return data_; }
+    size_t getSize() const { return size_; }
+    const std::string& getPath() const { return path_; }
+
+    /**
+     * Hint that the range will be read soon, so it is read ahead in the background
+     */
+    void prefetch(size_t offset, size_t size) const;
+
+    /**
+     * Hint that the mapping will be read front to back
+     */
+    void adviseSequential() const;
+
+private:
+    std::string path_;
+    void* data_;          // First mapped byte requested
+    size_t size_;
+    void* mapping_;       // Start of the mapping, aligned to the allocation granularity
+    size_t mappingSize_;
+#ifdef WIN32
+    void* file_;
+    void* fileMapping_;
+#endif
+};
+
+/**
+ * Hint that the range will be read soon. Pages of a file mapping are read ahead in the
+ * background, other memory is not affected.
+ */
+IVW_MODULE_PYDATA_API void prefetchMemory(const void* data, size_t size);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_MEMORYMAPPEDFILE_H
@@ -0,0 +1,112 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Shared between the calling thread and the pool tasks. Tasks that start after all jobs have
+// been taken return immediately, so the caller never waits for a queued task to be scheduled.
+struct ParallelState {
+    ParallelState(size_t jobs, std::function<void(size_t)> job)
+        : jobs(jobs), job(std::move(job)), next(0), finished(0) {}
+
+    void run() {
+        for (size_t i = next++; i < jobs; i = next++) {
+            std::exception_ptr exception;
+            try {
+                job(i);
+            } catch (...) {
+                exception = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (exception && !error) error = exception;
+            if (++finished == jobs) done.notify_all();
+        }
+    }
+
+    const size_t jobs;
+    const std::function<void(size_t)> job;
+    std::atomic<size_t> next;
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t finished;
+    std::exception_ptr error;
+};
+
+std::thread::id mainThread;
+
+} // namespace
+
+size_t getConcurrency() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallelFor(size_t jobs, std::function<void(size_t)> job) {
+    if (jobs == 0) return;
+
+    auto app = InviwoApplication::getPtr();
+    const size_t helpers = std::min(jobs, getConcurrency()) - 1;
+    if (!app || helpers == 0) {
+        for (size_t i = 0; i < jobs; ++i) job(i);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelState>(jobs, std::move(job));
+    for (size_t i = 0; i < helpers; ++i) app->dispatchPool([state]() { state->run(); });
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->finished == state->jobs; });
+    if (state->error) std::rethrow_exception(state->error);
+}
+
+void setMainThread() {
+    mainThread = std::this_thread::get_id();
+}
+
+bool isMainThread() {
+    return std::this_thread::get_id() == mainThread;
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,83 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_PARALLEL_H
+#define IVW_PYDATA_PARALLEL_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+#include <functional>
+#include <stdexcept>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Return the number of threads worth splitting a data parallel job over
+ */
+IVW_MODULE_PYDATA_API size_t getConcurrency();
+
+/**
+ * Run job(i) for every i in [0, jobs) on the Inviwo thread pool and wait for all of them to
+ * finish. The calling thread takes part in the work, which makes it safe to call from a pool
+ * thread. The first exception thrown by a job is rethrown once all jobs are done.
+ */
+IVW_MODULE_PYDATA_API void parallelFor(size_t jobs, std::function<void(size_t)> job);
+
+/**
+ * Register the calling thread as the main thread, called once by the module on construction
+ */
+IVW_MODULE_PYDATA_API void setMainThread();
+
+/**
+ * Return true if called from the main thread, i.e. the thread that evaluates the network
+ */
+IVW_MODULE_PYDATA_API bool isMainThread();
+
+/**
+ * Run f on the main thread and return its result, rethrowing what it throws. Calls from other
+ * threads wait for the main thread, so they must not hold the GIL or any lock the main thread
+ * may wait for.
+ */
+template <typename F>
+auto invokeOnMainThread(F f) -> decltype(f()) {
+    if (isMainThread()) return f();
+    auto inviwoApp = InviwoApplication::getPtr();
+    if (!inviwoApp) throw std::runtime_error("Cannot get reference to Inviwo application");
+    return inviwoApp->dispatchFront(std::move(f)).get();
+}
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_PARALLEL_H
@@ -0,0 +1,178 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PROCESSORHANDLE_H
+#define IVW_PROCESSORHANDLE_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+#include <inviwo/core/network/processornetwork.h>
+#include <inviwo/core/network/processornetworkobserver.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <mutex>
+#include <stdexcept>
+
+namespace inviwo {
+
+/**
+ * \class ProcessorHandle
+ * \brief Cached reference to a processor of type T in the network, identified by name
+ * The processor is looked up on first use and then cached. The handle observes the network and
+ * drops the cached processor whenever a processor is added or removed, so the name is resolved
+ * again once a processor may have been replaced. A renamed processor keeps answering to the
+ * handle until then. The network and the processor are only read, and the observer only added
+ * and removed, on the main thread, so handles may be created, used and destroyed on any thread.
+ */
+template <typename T>
+class ProcessorHandle {
+public:
+    using Lock = std::unique_lock<std::mutex>;
+
+    ProcessorHandle(std::string identifier);
+    ProcessorHandle(const ProcessorHandle&) = delete;
+    ProcessorHandle& operator=(const ProcessorHandle&) = delete;
+    ~ProcessorHandle();
+
+    const std::string& getIdentifier() const { return observer_->identifier; }
+
+    /**
+     * Return the processor, resolving it on the main thread if needed. The processor is not
+     * removed from the network while the given lock is held, so the lock should be released
+     * before anything that waits for the main thread, and must not be taken while holding the
+     * GIL. Throws std::runtime_error if there is no such processor.
+     */
+    T* get(Lock& lock);
+
+    /**
+     * True once the processor has been removed from the network, or could not be found with the
+     * type of the handle. The handle may still be used, the processor is then looked up again.
+     */
+    bool isStale() const;
+
+private:
+    // Registered with the network on the main thread. It is shared with the queued calls that
+    // add and remove it, so it outlives the handle until it has been removed.
+    struct Observer : public ProcessorNetworkObserver {
+        Observer(std::string identifier)
+            : identifier(std::move(identifier)), processor(nullptr), changes(0), stale(false) {}
+
+        virtual void onProcessorNetworkDidAddProcessor(Processor*) override {
+            Lock lock(mutex);
+            ++changes;
+            processor = nullptr;
+        }
+
+        virtual void onProcessorNetworkWillRemoveProcessor(Processor* removed) override {
+            const bool matches = removed->getIdentifier() == identifier;
+            Lock lock(mutex);
+            ++changes;
+            if (matches || removed == processor) stale = true;
+            processor = nullptr;
+        }
+
+        const std::string identifier;
+        mutable std::mutex mutex;
+        T* processor;
+        size_t changes;  // Processors added or removed so far, a lookup is stale if this changed
+        bool stale;
+    };
+
+    std::shared_ptr<Observer> observer_;
+};
+
+template <typename T>
+ProcessorHandle<T>::ProcessorHandle(std::string identifier)
+    : observer_(std::make_shared<Observer>(std::move(identifier))) {
+    auto inviwoApp = InviwoApplication::getPtr();
+    if (!inviwoApp) throw std::runtime_error("Cannot get reference to Inviwo application");
+
+    auto observer = observer_;
+    auto add = [observer]() {
+        InviwoApplication::getPtr()->getProcessorNetwork()->addObserver(observer.get());
+    };
+    if (pydata::isMainThread())
+        add();
+    else
+        inviwoApp->dispatchFront(add);
+}
+
+template <typename T>
+ProcessorHandle<T>::~ProcessorHandle() {
+    // The observer is removed after it has been added, calls are handled in order
+    auto observer = std::move(observer_);
+    auto remove = [observer]() mutable {
+        InviwoApplication::getPtr()->getProcessorNetwork()->removeObserver(observer.get());
+        observer.reset();
+    };
+    if (pydata::isMainThread())
+        remove();
+    else if (auto inviwoApp = InviwoApplication::getPtr())
+        inviwoApp->dispatchFront(remove);
+}
+
+template <typename T>
+T* ProcessorHandle<T>::get(Lock& lock) {
+    auto& observer = *observer_;
+    lock = Lock(observer.mutex);
+    while (true) {
+        // The cached processor is dropped by the observer on the main thread, it is not read here
+        if (observer.processor) return observer.processor;
+
+        // The main thread may be waiting for the lock to remove a processor, so it is released
+        // during the lookup. The lookup is repeated if the network changed meanwhile.
+        const size_t changes = observer.changes;
+        const std::string& identifier = observer.identifier;
+        lock.unlock();
+        auto processor = pydata::invokeOnMainThread([&identifier]() {
+            auto network = InviwoApplication::getPtr()->getProcessorNetwork();
+            return network->getProcessorByIdentifier(identifier);
+        });
+        lock.lock();
+        if (observer.changes != changes) continue;
+
+        auto typed = dynamic_cast<T*>(processor);
+        observer.stale = !typed;
+        if (!processor) throw std::runtime_error("Cannot find processor " + identifier);
+        if (!typed) throw std::runtime_error(identifier + " is not of the correct type");
+        observer.processor = typed;
+        return typed;
+    }
+}
+
+template <typename T>
+bool ProcessorHandle<T>::isStale() const {
+    Lock lock(observer_->mutex);
+    return observer_->stale;
+}
+
+} // namespace
+
+#endif // IVW_PROCESSORHANDLE_H
@@ -0,0 +1,174 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_PYRAMID_H
+#define IVW_PYDATA_PYRAMID_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <inviwo/core/common/inviwoapplication.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * \class Pyramid
+ * \brief Builds the levels of a mip pyramid on the thread pool
+ * Level 0 is the data itself and level i is downsampled by 2^i, each level is made from the one
+ * before it. In progressive mode the coarsest level is first made directly from level 0 and
+ * published on its own, so a preview is available long before the finer levels are done.
+ * Starting a new build cancels the previous one. Only the raw memory of the levels is read on
+ * the thread pool, the memory of level 0 is gathered by the caller on the main thread.
+ */
+template <typename T>
+class Pyramid {
+public:
+    using Levels = std::vector<std::shared_ptr<T>>;
+    /// A level and its packed data, which is all the downsampling reads
+    struct Source {
+        std::shared_ptr<T> data;  ///< Keeps the memory alive
+        const void* memory;
+        size3_t dimensions;
+    };
+    /// Return the source downsampled by factor, called from the thread pool
+    using Downsample = std::function<Source(const Source& source, size_t factor)>;
+    /// Receive the levels built so far, unbuilt levels are nullptr. Called from the thread pool.
+    using Publish = std::function<void(Levels levels, size_t generation)>;
+
+    Pyramid() : generation_(std::make_shared<std::atomic<size_t>>(0)) {}
+    ~Pyramid() { cancel(); }
+
+    /**
+     * Start building count levels from level 0. The lease is held until level 0 is no longer
+     * read, so the caller can tell when it may be written in place. Returns the generation of
+     * the build, which is passed along to publish.
+     */
+    size_t build(Source level0, std::shared_ptr<void> lease, size_t count, bool progressive,
+                 Downsample downsample, Publish publish) {
+        const size_t generation = ++*generation_;
+        auto current = generation_;
+        InviwoApplication::getPtr()->dispatchPool([=]() mutable {
+            try {
+                std::vector<Source> sources(count);
+                sources[0] = level0;
+                if (progressive && count > 2) {
+                    sources[count - 1] = downsample(level0, size_t(1) << (count - 1));
+                    if (*current != generation) return;
+                    publish(getLevels(sources), generation);
+                }
+                for (size_t i = 1; i < count; ++i) {
+                    sources[i] = downsample(sources[i - 1], 2);
+                    lease.reset();
+                    if (*current != generation) return;
+                }
+                publish(getLevels(sources), generation);
+            } catch (const std::exception& e) {
+                LogErrorCustom("Pyramid", "Building the pyramid failed: " << e.what());
+            }
+        });
+        return generation;
+    }
+
+    /**
+     * Cancel the current build, if any. Levels being downsampled are finished but not published.
+     */
+    void cancel() { ++*generation_; }
+
+    /**
+     * Return true if the generation is the latest build and has not been cancelled
+     */
+    bool isCurrent(size_t generation) const { return *generation_ == generation; }
+
+    /**
+     * Return a publish function that passes the levels to receive on the main thread. Levels
+     * arriving after a newer build has started, or once alive has expired, are dropped.
+     */
+    Publish publishOnMainThread(std::weak_ptr<bool> alive,
+                                std::function<void(Levels levels)> receive) const {
+        auto current = generation_;
+        return [current, alive, receive](Levels levels, size_t generation) {
+            InviwoApplication::getPtr()->dispatchFront([current, alive, receive, levels,
+                                                        generation]() {
+                if (!alive.lock() || *current != generation) return;
+                receive(levels);
+            });
+        };
+    }
+
+    /**
+     * Return the level to show for the selected one, or the nearest coarser one that is done
+     * while it is built. Finer levels are only returned if finer is set, e.g. if nothing is shown
+     * yet. Returns nullptr if there is no such level.
+     */
+    static std::shared_ptr<T> getShownLevel(const Levels& levels, size_t selected, bool finer) {
+        for (size_t i = selected; i < levels.size(); ++i) {
+            if (levels[i]) return levels[i];
+        }
+        if (!finer)
+            return nullptr;
+        for (size_t i = std::min(selected, levels.size()); i-- > 0;) {
+            if (levels[i]) return levels[i];
+        }
+        return nullptr;
+    }
+
+    /**
+     * Take the level with the given data out of the levels, leaving nullptr in its place. Level 0
+     * is the data itself and is never taken. Returns nullptr if no level matches.
+     */
+    static std::shared_ptr<T> takeLevel(Levels& levels, const T* key) {
+        for (size_t i = 1; i < levels.size(); ++i) {
+            if (levels[i].get() == key) return std::move(levels[i]);
+        }
+        return nullptr;
+    }
+
+private:
+    static Levels getLevels(const std::vector<Source>& sources) {
+        Levels levels;
+        for (const auto& source : sources)
+            levels.push_back(source.data);
+        return levels;
+    }
+
+    std::shared_ptr<std::atomic<size_t>> generation_;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_PYRAMID_H
@@ -0,0 +1,271 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/sharedmemoryring.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+constexpr std::uint32_t ringMagic = 0x52575649;  // "IVWR" in little-endian
+constexpr std::uint32_t ringVersion = 1;
+constexpr size_t maxDimensions = 4;
+
+struct RingHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t slotCount;
+    std::atomic<std::uint32_t> reader;  // Process id, 0 if none
+    std::uint64_t slotSize;
+    std::atomic<std::uint64_t> writeSequence;
+    std::atomic<std::uint64_t> readSequence;
+    std::uint8_t reserved[24];
+};
+
+struct SlotHeader {
+    std::atomic<std::uint64_t> sequence;
+    std::uint32_t kind;
+    std::uint32_t ndim;
+    std::uint64_t shape[maxDimensions];
+    char format[8];
+    std::uint64_t reserved;
+};
+
+static_assert(sizeof(std::atomic<std::uint64_t>) == 8 && sizeof(std::atomic<std::uint32_t>) == 4,
+              "Atomics must have the size of the values they hold");
+static_assert(sizeof(RingHeader) == 64, "The ring header must be 64 bytes");
+static_assert(sizeof(SlotHeader) == 64, "Slot headers must be 64 bytes");
+
+RingHeader* getHeader(void* memory) { return static_cast<RingHeader*>(memory); }
+
+SlotHeader* getSlot(void* memory, size_t slot) {
+    return reinterpret_cast<SlotHeader*>(static_cast<char*>(memory) + sizeof(RingHeader)) + slot;
+}
+
+size_t getDataOffset(size_t slotCount) {
+    return (sizeof(RingHeader) + slotCount * sizeof(SlotHeader) + 63) / 64 * 64;
+}
+
+} // namespace
+
+#ifdef WIN32
+
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::attach(const std::string&) {
+    throw std::runtime_error("Shared memory rings are only supported on POSIX systems");
+}
+
+SharedMemoryRing::~SharedMemoryRing() = default;
+
+std::shared_ptr<void> SharedMemoryRing::mapFrame(size_t, size_t) const {
+    throw std::runtime_error("Shared memory rings are only supported on POSIX systems");
+}
+
+#else
+
+std::shared_ptr<SharedMemoryRing> SharedMemoryRing::attach(const std::string& name) {
+    const std::string path = name.empty() || name[0] != '/' ? "/" + name : name;
+    int file = shm_open(path.c_str(), O_RDWR, 0);
+    if (file < 0)
+        throw std::runtime_error("Cannot open shared memory " + name);
+
+    // The layout is read before anything is mapped
+    struct stat status;
+    RingHeader header;
+    if (fstat(file, &status) != 0 || static_cast<size_t>(status.st_size) < sizeof(RingHeader) ||
+        pread(file, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+        close(file);
+        throw std::runtime_error("Shared memory " + name + " is too small for a ring");
+    }
+
+    const size_t size = static_cast<size_t>(status.st_size);
+    std::string error;
+    if (header.magic != ringMagic || header.version != ringVersion)
+        error = "Shared memory " + name + " is not a version 1 ring";
+    else if (header.slotCount < 2 || header.slotSize % 64 != 0 ||
+             getDataOffset(header.slotCount) + header.slotCount * header.slotSize > size)
+        error = "Shared memory " + name + " has an invalid ring layout";
+    if (!error.empty()) {
+        close(file);
+        throw std::runtime_error(error);
+    }
+
+    // Only the headers are mapped shared, frames are mapped when they are leased
+    const size_t headersSize = getDataOffset(header.slotCount);
+    void* headers = mmap(nullptr, headersSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (headers == MAP_FAILED) {
+        close(file);
+        throw std::runtime_error("Cannot map shared memory " + name);
+    }
+
+    // The ring has a single read sequence, a second reader would move it under the first one.
+    // The slot of a reader that exited without detaching, e.g. after a crash, is taken over.
+    const auto pid = static_cast<std::uint32_t>(getpid());
+    auto& reader = getHeader(headers)->reader;
+    std::uint32_t owner = 0;
+    while (!reader.compare_exchange_strong(owner, pid, std::memory_order_acq_rel)) {
+        if (owner == 0)
+            continue;
+        if (kill(static_cast<pid_t>(owner), 0) == 0 || errno != ESRCH) {
+            munmap(headers, headersSize);
+            close(file);
+            throw std::runtime_error("Shared memory " + name + " already has a reader");
+        }
+    }
+
+    return std::shared_ptr<SharedMemoryRing>(
+        new SharedMemoryRing(name, file, headers, headersSize));
+}
+
+SharedMemoryRing::~SharedMemoryRing() {
+    // Leave the slot alone if another reader took it over, e.g. after this process was stopped
+    auto pid = static_cast<std::uint32_t>(getpid());
+    getHeader(headers_)->reader.compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+    munmap(headers_, headersSize_);
+    close(file_);
+}
+
+std::shared_ptr<void> SharedMemoryRing::mapFrame(size_t offset, size_t size) const {
+    // Copy-on-write, so consumers editing the frame get private pages and never write into the
+    // ring. Pages not written to still show the data of the writer.
+    const size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const size_t alignedOffset = offset - offset % pageSize;
+    const size_t mappingSize = std::max<size_t>(1, size + (offset - alignedOffset));
+    void* mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, file_,
+                         static_cast<off_t>(alignedOffset));
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("Cannot map frame of " + name_);
+    return std::shared_ptr<void>(static_cast<char*>(mapping) + (offset - alignedOffset),
+                                 [mapping, mappingSize](void*) { munmap(mapping, mappingSize); });
+}
+
+#endif
+
+SharedMemoryRing::SharedMemoryRing(const std::string& name, int file, void* headers,
+                                   size_t headersSize)
+    : name_(name)
+    , file_(file)
+    , headers_(headers)
+    , headersSize_(headersSize)
+    , nextSequence_(0) {
+    // Frames before the current one may be overwritten, the writer is at most one frame ahead
+    auto header = getHeader(headers_);
+    const auto sequence = header->writeSequence.load(std::memory_order_acquire);
+    header->readSequence.store(sequence > 0 ? sequence - 1 : 0, std::memory_order_release);
+}
+
+std::uint64_t SharedMemoryRing::getWriteSequence() const {
+    return getHeader(headers_)->writeSequence.load(std::memory_order_acquire);
+}
+
+bool SharedMemoryRing::acquireLatest(Frame& frame) {
+    auto header = getHeader(headers_);
+    const auto writeSequence = header->writeSequence.load(std::memory_order_acquire);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (writeSequence == 0 || writeSequence - 1 < nextSequence_)
+        return false;
+    const std::uint64_t sequence = writeSequence - 1;
+
+    auto slot = getSlot(headers_, sequence % header->slotCount);
+    const auto slotSequence = slot->sequence.load(std::memory_order_acquire);
+    if (slotSequence != 2 * sequence + 2)
+        return false;
+
+    // Lease the frame before reading its description, the writer does not start on the slot
+    // once the read sequence is at most this frame
+    leases_.insert(sequence);
+    nextSequence_ = sequence + 1;
+    header->readSequence.store(*leases_.begin(), std::memory_order_release);
+    lock.unlock();
+
+    auto self = shared_from_this();
+    std::shared_ptr<void> lease(nullptr, [self, sequence](void*) { self->release(sequence); });
+
+    frame.sequence = sequence;
+    frame.kind = static_cast<Kind>(slot->kind);
+    const size_t ndim = std::min<size_t>(slot->ndim, maxDimensions);
+    frame.shape.assign(slot->shape, slot->shape + ndim);
+    const std::string format(slot->format, strnlen(slot->format, sizeof(slot->format)));
+
+    // The description is only valid if the slot was not rewritten while it was read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->sequence.load(std::memory_order_relaxed) != slotSequence ||
+        slot->ndim != ndim || (frame.kind != Kind::Volume && frame.kind != Kind::Image))
+        return false;
+
+    frame.format = getBufferFormat(format);
+    size_t bytes = frame.format.itemsize;
+    for (auto extent : frame.shape)
+        bytes *= extent;
+    if (bytes > header->slotSize)
+        throw std::runtime_error("Frame is larger than the slots of " + name_);
+
+    // The mapping is dropped before the slot is returned to the writer
+    auto mapping = mapFrame(getDataOffset(header->slotCount) +
+                                (sequence % header->slotCount) * header->slotSize,
+                            bytes);
+    frame.data = mapping.get();
+    frame.lease = std::shared_ptr<void>(frame.data, [lease, mapping](void*) mutable {
+        mapping.reset();
+        lease.reset();
+    });
+    return true;
+}
+
+void SharedMemoryRing::release(std::uint64_t sequence) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = leases_.find(sequence);
+    if (it != leases_.end())
+        leases_.erase(it);
+
+    // Without leases everything before the next frame may be overwritten
+    auto header = getHeader(headers_);
+    header->readSequence.store(leases_.empty() ? nextSequence_ : *leases_.begin(),
+                               std::memory_order_release);
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,135 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_PYDATA_SHAREDMEMORYRING_H
+#define IVW_PYDATA_SHAREDMEMORYRING_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <modules/pydata/util/bufferformat.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <set>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * \class SharedMemoryRing
+ * \brief Reader side of a ring of frames in POSIX shared memory, written by another process
+ *
+ * The memory starts with a 64 byte header followed by one 64 byte header per slot and the slot
+ * data, all little-endian on the supported platforms:
+ *
+ *     Ring header                       Slot header
+ *     0  uint32 magic 'IVWR'            0  uint64 sequence, 2f+1 while frame f is written,
+ *     4  uint32 version (1)                       2f+2 once it is done
+ *     8  uint32 slot count              8  uint32 kind, 0 volume, 1 image
+ *     12 uint32 reader pid, 0 if none   12 uint32 number of dimensions
+ *     16 uint64 slot size in bytes      16 uint64 shape[4], in NumPy index order
+ *     24 uint64 write sequence          48 char   format[8], PEP 3118 format code
+ *     32 uint64 read sequence
+ *
+ * Slot data starts at the first multiple of 64 after the slot headers, slot i at i * slot size.
+ * Frame f is written to slot f % slots, after which the write sequence is set to f + 1.
+ *
+ * Frames are leased to the reader without copying. The read sequence is the oldest frame still
+ * leased, and the writer may only write frame f if f < read sequence + slots or no reader is
+ * attached. Both sequences only grow, so a stale value seen by either side is on the safe side.
+ * There is a single read sequence, so only one reader may be attached at a time. The reader
+ * stores its process id in the header, a ring whose reader process no longer exists may be
+ * attached to again and is written to as if it had no reader.
+ *
+ * Only the headers are mapped shared. Each leased frame is mapped copy-on-write, so consumers
+ * may edit it through an ordinary editable representation without writing into the ring.
+ */
+class IVW_MODULE_PYDATA_API SharedMemoryRing
+    : public std::enable_shared_from_this<SharedMemoryRing> {
+public:
+    enum class Kind { Volume = 0, Image = 1 };
+
+    /**
+     * A frame leased from the ring. The slot is not written to while the lease is alive.
+     */
+    struct Frame {
+        std::uint64_t sequence;
+        Kind kind;
+        std::vector<size_t> shape;
+        BufferFormat format;
+        void* data;
+        std::shared_ptr<void> lease;
+    };
+
+    /**
+     * Attach to the ring in the named shared memory object. Throws if it does not exist, is not
+     * a valid ring, or already has a reader that is still running.
+     */
+    static std::shared_ptr<SharedMemoryRing> attach(const std::string& name);
+
+    SharedMemoryRing(const SharedMemoryRing&) = delete;
+    SharedMemoryRing& operator=(const SharedMemoryRing&) = delete;
+    ~SharedMemoryRing();
+
+    const std::string& getName() const { return name_; }
+
+    /**
+     * Return the number of frames written so far
+     */
+    std::uint64_t getWriteSequence() const;
+
+    /**
+     * Lease the most recently written frame. Returns false if there is no frame newer than the
+     * last one leased, or if it could not be read consistently.
+     */
+    bool acquireLatest(Frame& frame);
+
+private:
+    SharedMemoryRing(const std::string& name, int file, void* headers, size_t headersSize);
+    // Map size bytes at offset into the shared memory copy-on-write, unmapped with the pointer
+    std::shared_ptr<void> mapFrame(size_t offset, size_t size) const;
+    void release(std::uint64_t sequence);
+
+    std::string name_;
+    int file_;
+    void* headers_;  // The ring and slot headers, mapped shared
+    size_t headersSize_;
+
+    std::mutex mutex_;
+    std::multiset<std::uint64_t> leases_;
+    std::uint64_t nextSequence_;  // Frames before this have already been leased
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_PYDATA_SHAREDMEMORYRING_H
@@ -0,0 +1,233 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/stridedcopy.h>
+#include <modules/pydata/util/parallel.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+// Amount of data handled by each parallel job
+constexpr size_t jobBytes = 1 << 20;
+// Side length, in elements, of the tiles used for transposed copies
+constexpr size_t tileSize = 32;
+
+struct Axis {
+    size_t size;
+    std::ptrdiff_t src;
+    std::ptrdiff_t dst;
+};
+
+// Copy count elements of N bytes, the constant size lets the compiler turn the memcpy into
+// plain loads and stores and vectorize the loop
+template <size_t N>
+void copyLine(const char* src, std::ptrdiff_t srcStep, char* dst, std::ptrdiff_t dstStep,
+              size_t count, size_t) {
+    for (size_t i = 0; i < count; ++i, src += srcStep, dst += dstStep) std::memcpy(dst, src, N);
+}
+
+void copyLineAny(const char* src, std::ptrdiff_t srcStep, char* dst, std::ptrdiff_t dstStep,
+                 size_t count, size_t elementSize) {
+    if (srcStep == static_cast<std::ptrdiff_t>(elementSize) && srcStep == dstStep) {
+        std::memcpy(dst, src, count * elementSize);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i, src += srcStep, dst += dstStep)
+        std::memcpy(dst, src, elementSize);
+}
+
+using LineCopy = void (*)(const char*, std::ptrdiff_t, char*, std::ptrdiff_t, size_t, size_t);
+
+LineCopy getLineCopy(size_t elementSize) {
+    switch (elementSize) {
+        case 1: return &copyLine<1>;
+        case 2: return &copyLine<2>;
+        case 3: return &copyLine<3>;
+        case 4: return &copyLine<4>;
+        case 6: return &copyLine<6>;
+        case 8: return &copyLine<8>;
+        case 12: return &copyLine<12>;
+        case 16: return &copyLine<16>;
+        case 24: return &copyLine<24>;
+        case 32: return &copyLine<32>;
+        default: return &copyLineAny;
+    }
+}
+
+// Offsets of the element with the given linear index over the axes [0, count)
+void getOffsets(const std::vector<Axis>& axes, size_t count, size_t index, std::ptrdiff_t& src,
+                std::ptrdiff_t& dst) {
+    src = 0;
+    dst = 0;
+    for (size_t i = count; i-- > 0;) {
+        const auto pos = static_cast<std::ptrdiff_t>(index % axes[i].size);
+        index /= axes[i].size;
+        src += pos * axes[i].src;
+        dst += pos * axes[i].dst;
+    }
+}
+
+void copyContiguous(const char* src, char* dst, size_t bytes, size_t itemsize,
+                    CopyVisitor* visitor) {
+    const size_t jobs = (bytes + jobBytes - 1) / jobBytes;
+    parallelFor(jobs, [&](size_t job) {
+        const size_t begin = job * jobBytes;
+        const size_t size = std::min(jobBytes, bytes - begin);
+        std::memcpy(dst + begin, src + begin, size);
+        if (visitor) {
+            auto visit = visitor->beginJob();
+            visit->visit(dst + begin, itemsize, size / itemsize, itemsize);
+            visitor->endJob(std::move(visit));
+        }
+    });
+}
+
+} // namespace
+
+std::vector<std::ptrdiff_t> getPackedStrides(const std::vector<size_t>& shape, size_t itemsize) {
+    std::vector<std::ptrdiff_t> strides(shape.size());
+    auto stride = static_cast<std::ptrdiff_t>(itemsize);
+    for (size_t i = shape.size(); i-- > 0;) {
+        strides[i] = stride;
+        stride *= static_cast<std::ptrdiff_t>(shape[i]);
+    }
+    return strides;
+}
+
+void copyStrided(const void* srcPtr, const std::vector<std::ptrdiff_t>& srcStrides, void* dstPtr,
+                 const std::vector<std::ptrdiff_t>& dstStrides, const std::vector<size_t>& shape,
+                 size_t itemsize, CopyVisitor* visitor) {
+    const char* src = static_cast<const char*>(srcPtr);
+    char* dst = static_cast<char*>(dstPtr);
+
+    // Drop empty axes and merge axes that are contiguous in both layouts
+    std::vector<Axis> axes;
+    for (size_t i = 0; i < shape.size(); ++i) {
+        if (shape[i] == 0) return;
+        if (shape[i] == 1) continue;
+        Axis axis{shape[i], srcStrides[i], dstStrides[i]};
+        if (!axes.empty() && axes.back().src == axis.src * static_cast<std::ptrdiff_t>(axis.size) &&
+            axes.back().dst == axis.dst * static_cast<std::ptrdiff_t>(axis.size)) {
+            axes.back().size *= axis.size;
+            axes.back().src = axis.src;
+            axes.back().dst = axis.dst;
+        } else {
+            axes.push_back(axis);
+        }
+    }
+
+    // Fold a trailing axis that is contiguous in both layouts into the element
+    size_t elementSize = itemsize;
+    if (!axes.empty() && axes.back().src == static_cast<std::ptrdiff_t>(itemsize) &&
+        axes.back().dst == static_cast<std::ptrdiff_t>(itemsize)) {
+        elementSize *= axes.back().size;
+        axes.pop_back();
+    }
+
+    if (axes.empty()) {
+        copyContiguous(src, dst, elementSize, itemsize, visitor);
+        return;
+    }
+
+    const auto copyLine = getLineCopy(elementSize);
+    const size_t inner = axes.size() - 1;
+    const Axis row = axes[inner];
+
+    // Find the axis along which the source is read most efficiently
+    size_t fast = inner;
+    for (size_t i = 0; i < inner; ++i) {
+        if (std::abs(axes[i].src) < std::abs(axes[fast].src)) fast = i;
+    }
+
+    if (fast == inner) {
+        // Copy line by line along the innermost axis, the source is read in order
+        size_t rows = 1;
+        for (size_t i = 0; i < inner; ++i) rows *= axes[i].size;
+        const size_t rowsPerJob = std::max<size_t>(1, jobBytes / (row.size * elementSize));
+        const size_t jobs = (rows + rowsPerJob - 1) / rowsPerJob;
+
+        parallelFor(jobs, [&](size_t job) {
+            auto visit = visitor ? visitor->beginJob() : nullptr;
+            const size_t end = std::min(rows, (job + 1) * rowsPerJob);
+            for (size_t r = job * rowsPerJob; r < end; ++r) {
+                std::ptrdiff_t srcOffset, dstOffset;
+                getOffsets(axes, inner, r, srcOffset, dstOffset);
+                copyLine(src + srcOffset, row.src, dst + dstOffset, row.dst, row.size, elementSize);
+                if (visit) visit->visit(dst + dstOffset, row.dst, row.size, elementSize);
+            }
+            if (visitor) visitor->endJob(std::move(visit));
+        });
+    } else {
+        // Transposed layout, each job copies a strip of tileSize elements along the fast source
+        // axis for every position along the innermost destination axis, so that the lines read
+        // and the lines written both stay within the cache
+        const Axis column = axes[fast];
+        std::vector<Axis> outer;
+        for (size_t i = 0; i < inner; ++i) {
+            if (i != fast) outer.push_back(axes[i]);
+        }
+        size_t outerCount = 1;
+        for (const auto& axis : outer) outerCount *= axis.size;
+        const size_t tiles = (column.size + tileSize - 1) / tileSize;
+
+        parallelFor(outerCount * tiles, [&](size_t job) {
+            std::ptrdiff_t srcOffset, dstOffset;
+            getOffsets(outer, outer.size(), job / tiles, srcOffset, dstOffset);
+            const size_t c0 = (job % tiles) * tileSize;
+            const size_t c1 = std::min(column.size, c0 + tileSize);
+            for (size_t r = 0; r < row.size; ++r) {
+                const auto s = srcOffset + static_cast<std::ptrdiff_t>(r) * row.src +
+                               static_cast<std::ptrdiff_t>(c0) * column.src;
+                const auto d = dstOffset + static_cast<std::ptrdiff_t>(r) * row.dst +
+                               static_cast<std::ptrdiff_t>(c0) * column.dst;
+                copyLine(src + s, column.src, dst + d, column.dst, c1 - c0, elementSize);
+            }
+            // The job has written complete lines along the innermost axis
+            if (visitor) {
+                auto visit = visitor->beginJob();
+                for (size_t c = c0; c < c1; ++c) {
+                    visit->visit(dst + dstOffset + static_cast<std::ptrdiff_t>(c) * column.dst,
+                                 row.dst, row.size, elementSize);
+                }
+                visitor->endJob(std::move(visit));
+            }
+        });
+    }
+}
+
+} // namespace
+
+} // namespace
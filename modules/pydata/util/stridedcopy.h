@@ -0,0 +1,89 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_STRIDEDCOPY_H
+#define IVW_STRIDEDCOPY_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace inviwo {
+
+namespace pydata {
+
+/**
+ * Return the byte strides of a packed array stored in row-major order
+ */
+IVW_MODULE_PYDATA_API std::vector<std::ptrdiff_t> getPackedStrides(
+    const std::vector<size_t>& shape, size_t itemsize);
+
+/**
+ * \class CopyVisitor
+ * \brief Inspects the data written by copyStrided while it is still in the cache
+ * Every parallel job of the copy begins its own Job, passes it the lines it has written and
+ * hands it back when done. Jobs run concurrently, endJob has to be thread safe.
+ */
+class IVW_MODULE_PYDATA_API CopyVisitor {
+public:
+    class Job {
+    public:
+        virtual ~Job() = default;
+        /**
+         * Inspect count elements of elementSize bytes, placed step bytes apart. The element size
+         * is always a multiple of the item size given to copyStrided.
+         */
+        virtual void visit(const char* data, std::ptrdiff_t step, size_t count,
+                           size_t elementSize) = 0;
+    };
+
+    virtual ~CopyVisitor() = default;
+    virtual std::unique_ptr<Job> beginJob() = 0;
+    virtual void endJob(std::unique_ptr<Job> job) = 0;
+};
+
+/**
+ * Copy an n-dimensional array between two strided memory layouts. Strides are given in bytes
+ * and may be negative, the pointers refer to the first element of each array. Contiguous runs
+ * are copied with memcpy, transposed layouts are copied in cache sized tiles, and the work is
+ * split over the Inviwo thread pool. An optional visitor sees every written element once.
+ */
+IVW_MODULE_PYDATA_API void copyStrided(const void* src, const std::vector<std::ptrdiff_t>& srcStrides,
+                                       void* dst, const std::vector<std::ptrdiff_t>& dstStrides,
+                                       const std::vector<size_t>& shape, size_t itemsize,
+                                       CopyVisitor* visitor = nullptr);
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_STRIDEDCOPY_H
@@ -0,0 +1,224 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#include <modules/pydata/util/valuestats.h>
+#include <modules/pydata/util/convert.h>
+#include <modules/pydata/util/parallel.h>
+#include <inviwo/core/util/formats.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+
+namespace inviwo {
+
+namespace pydata {
+
+namespace {
+
+constexpr size_t scanBytes = 1 << 20;
+
+// Half precision float, stored as its bits and compared as float
+struct Half {};
+
+// The type data is stored as and the type its values are compared in
+template <typename T>
+struct Stored {
+    using type = T;
+    using value = T;
+    static T load(T stored) { return stored; }
+};
+
+template <>
+struct Stored<Half> {
+    using type = std::uint16_t;
+    using value = float;
+    static float load(std::uint16_t stored) { return halfToFloat(stored); }
+};
+
+template <typename T>
+class ValueStatsVisitorT : public ValueStatsVisitor {
+public:
+    using S = typename Stored<T>::type;
+    using V = typename Stored<T>::value;
+
+    ValueStatsVisitorT(size_t bins, dvec2 histogramRange)
+        : bins_(bins)
+        , histogramRange_(histogramRange)
+        , histogramKnown_(histogramRange.x < histogramRange.y)
+        , min_(std::numeric_limits<V>::max())
+        , max_(std::numeric_limits<V>::lowest())
+        , histogram_(bins, 0) {}
+
+    class Job : public CopyVisitor::Job {
+    public:
+        Job(size_t bins, dvec2 histogramRange)
+            : min(std::numeric_limits<V>::max())
+            , max(std::numeric_limits<V>::lowest())
+            , histogram(bins, 0)
+            , lower(histogramRange.x)
+            , scale(bins > 0 ? bins / (histogramRange.y - histogramRange.x) : 0.0) {}
+
+        virtual void visit(const char* data, std::ptrdiff_t step, size_t count,
+                           size_t elementSize) override {
+            const size_t components = elementSize / sizeof(S);
+            if (step == static_cast<std::ptrdiff_t>(elementSize)) {
+                add(reinterpret_cast<const S*>(data), count * components);
+            } else {
+                for (size_t i = 0; i < count; ++i, data += step)
+                    add(reinterpret_cast<const S*>(data), components);
+            }
+        }
+
+        void add(const S* values, size_t count) {
+            V localMin = min, localMax = max;
+            for (size_t i = 0; i < count; ++i) {
+                // NaN values fail both comparisons and are skipped
+                const V value = Stored<T>::load(values[i]);
+                localMin = std::min(localMin, value);
+                localMax = std::max(localMax, value);
+            }
+            min = localMin;
+            max = localMax;
+            if (!histogram.empty()) addToHistogram(values, count);
+        }
+
+        void addToHistogram(const S* values, size_t count) {
+            const double bins = static_cast<double>(histogram.size());
+            for (size_t i = 0; i < count; ++i) {
+                const double value = static_cast<double>(Stored<T>::load(values[i]));
+                const double bin = (value - lower) * scale;
+                if (bin >= 0.0 && bin <= bins)
+                    ++histogram[std::min(static_cast<size_t>(bin), histogram.size() - 1)];
+            }
+        }
+
+        V min;
+        V max;
+        std::vector<size_t> histogram;
+        double lower;
+        double scale;
+    };
+
+    virtual std::unique_ptr<CopyVisitor::Job> beginJob() override {
+        return util::make_unique<Job>(histogramKnown_ ? bins_ : 0, histogramRange_);
+    }
+
+    virtual void endJob(std::unique_ptr<CopyVisitor::Job> job) override {
+        auto& result = static_cast<Job&>(*job);
+        std::lock_guard<std::mutex> lock(mutex_);
+        min_ = std::min(min_, result.min);
+        max_ = std::max(max_, result.max);
+        for (size_t i = 0; i < result.histogram.size(); ++i) histogram_[i] += result.histogram[i];
+    }
+
+    virtual ValueStats finish(const void* data, size_t bytes) override {
+        ValueStats stats;
+        stats.range = min_ <= max_ ? dvec2(min_, max_) : dvec2(0.0);
+
+        if (bins_ > 0 && !histogramKnown_) {
+            // Second pass over the value range, widened to give an empty range a width
+            histogramRange_ = stats.range;
+            if (histogramRange_.x == histogramRange_.y) histogramRange_ += dvec2(-0.5, 0.5);
+            histogramKnown_ = true;
+            scan(data, bytes);
+        }
+        stats.histogramRange = histogramRange_;
+        if (bins_ > 0) stats.histogram = histogram_;
+        return stats;
+    }
+
+private:
+    const size_t bins_;
+    dvec2 histogramRange_;
+    bool histogramKnown_;
+
+    std::mutex mutex_;
+    V min_;
+    V max_;
+    std::vector<size_t> histogram_;
+};
+
+// The full range of 8-bit types is covered by the histogram without knowing the data
+template <typename T>
+std::unique_ptr<ValueStatsVisitor> createVisitor(size_t bins, dvec2 histogramRange) {
+    using S = typename Stored<T>::type;
+    if (sizeof(S) == 1 && histogramRange.x >= histogramRange.y) {
+        histogramRange = dvec2(std::numeric_limits<S>::lowest(), std::numeric_limits<S>::max());
+        histogramRange.y += 1.0;
+    }
+    return util::make_unique<ValueStatsVisitorT<T>>(bins, histogramRange);
+}
+
+} // namespace
+
+std::unique_ptr<ValueStatsVisitor> ValueStatsVisitor::create(const DataFormatBase* format,
+                                                             size_t bins, dvec2 histogramRange) {
+    const size_t bytes = format->getSize() / format->getComponents();
+    switch (format->getNumericType()) {
+        case NumericType::Float:
+            if (bytes == 2) return createVisitor<Half>(bins, histogramRange);
+            if (bytes == 4) return createVisitor<float>(bins, histogramRange);
+            if (bytes == 8) return createVisitor<double>(bins, histogramRange);
+            break;
+        case NumericType::SignedInteger:
+            if (bytes == 1) return createVisitor<std::int8_t>(bins, histogramRange);
+            if (bytes == 2) return createVisitor<std::int16_t>(bins, histogramRange);
+            if (bytes == 4) return createVisitor<std::int32_t>(bins, histogramRange);
+            if (bytes == 8) return createVisitor<std::int64_t>(bins, histogramRange);
+            break;
+        case NumericType::UnsignedInteger:
+            if (bytes == 1) return createVisitor<std::uint8_t>(bins, histogramRange);
+            if (bytes == 2) return createVisitor<std::uint16_t>(bins, histogramRange);
+            if (bytes == 4) return createVisitor<std::uint32_t>(bins, histogramRange);
+            if (bytes == 8) return createVisitor<std::uint64_t>(bins, histogramRange);
+            break;
+        default:
+            break;
+    }
+    throw Exception("Value statistics not supported for " + std::string(format->getString()),
+                    IvwContextCustom("ValueStatsVisitor"));
+}
+
+void ValueStatsVisitor::scan(const void* data, size_t bytes) {
+    auto bytePtr = static_cast<const char*>(data);
+    const size_t jobs = (bytes + scanBytes - 1) / scanBytes;
+    parallelFor(jobs, [&](size_t job) {
+        const size_t begin = job * scanBytes;
+        const size_t size = std::min(scanBytes, bytes - begin);
+        auto visit = beginJob();
+        visit->visit(bytePtr + begin, size, 1, size);
+        endJob(std::move(visit));
+    });
+}
+
+} // namespace
+
+} // namespace
@@ -0,0 +1,87 @@
+/*********************************************************************************
+ *
+ * Inviwo - Interactive Visualization Workshop
+ *
+ * Copyright (c) 2016 Inviwo Foundation
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ * 
+ *********************************************************************************/
+
+#ifndef IVW_VALUESTATS_H
+#define IVW_VALUESTATS_H
+
+#include <modules/pydata/pydatamoduledefine.h>
+#include <inviwo/core/common/inviwo.h>
+#include <modules/pydata/util/stridedcopy.h>
+
+namespace inviwo {
+
+class DataFormatBase;
+
+namespace pydata {
+
+/**
+ * Value statistics of a data set, taken over all components. Half precision floats are
+ * supported along with all other scalar types.
+ */
+struct IVW_MODULE_PYDATA_API ValueStats {
+    dvec2 range;                    ///< Minimum and maximum value
+    dvec2 histogramRange;           ///< Values covered by the histogram
+    std::vector<size_t> histogram;  ///< Bin counts, empty if no histogram was requested
+};
+
+/**
+ * \class ValueStatsVisitor
+ * \brief Computes the ValueStats of data while it is written by copyStrided
+ * The histogram is filled in the same pass when its range is known up front, i.e. given
+ * explicitly or implied by an 8-bit integer format. Otherwise finish makes a second pass over
+ * the data once the value range is known.
+ */
+class IVW_MODULE_PYDATA_API ValueStatsVisitor : public CopyVisitor {
+public:
+    /**
+     * Create a visitor for data of the given format. A histogram with the given number of bins
+     * is computed if bins > 0, over histogramRange if it is non-empty.
+     */
+    static std::unique_ptr<ValueStatsVisitor> create(const DataFormatBase* format, size_t bins,
+                                                     dvec2 histogramRange = dvec2(0.0));
+
+    virtual ~ValueStatsVisitor() = default;
+
+    /**
+     * Visit packed data that has not been written by copyStrided, e.g. borrowed data
+     */
+    void scan(const void* data, size_t bytes);
+
+    /**
+     * Return the statistics of all visited data. The packed data is needed for the second
+     * histogram pass, if any.
+     */
+    virtual ValueStats finish(const void* data, size_t bytes) = 0;
+};
+
+} // namespace
+
+} // namespace
+
+#endif // IVW_VALUESTATS_H